@@ -0,0 +1,150 @@
+/*
+ * arena.c - region allocation layered on the mm package.
+ *
+ * An arena bump-allocates from large chunks that it obtains with
+ * mm_malloc. Individual arena blocks are never freed; instead
+ * mm_arena_reset releases every block in the arena at once by
+ * rewinding the bump pointer to the first chunk. The chunks themselves
+ * are kept for reuse and only go back to the mm package when the arena
+ * is destroyed. This makes the cost of a request-scoped workload one
+ * bump per allocation plus one reset, instead of one mm_free (with its
+ * coalesce and free list insertion) per block.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "mm.h"
+#include "config.h"
+
+/* Default number of bytes requested from mm_malloc per chunk */
+#define ARENA_CHUNKSIZE (1<<12)
+
+/* Rounds up to the nearest multiple of ALIGNMENT */
+#define ARENA_ALIGN(size) (((size) + (ALIGNMENT-1)) & ~(ALIGNMENT-1))
+
+/* Every chunk starts with this header; its data follows, aligned */
+typedef struct chunk_t {
+    struct chunk_t *next;  /* next chunk in the arena */
+    char *end;             /* one past the last usable byte */
+} chunk_t;
+
+#define CHUNK_HDRSIZE  ARENA_ALIGN(sizeof(chunk_t))
+#define CHUNK_DATA(c)  ((char *)(c) + CHUNK_HDRSIZE)
+
+struct mm_arena {
+    chunk_t *first;        /* first chunk, where a reset rewinds to */
+    chunk_t *cur;          /* chunk currently being carved (NULL after reset) */
+    char *ptr;             /* next free byte in cur */
+    char *end;             /* end of cur */
+    size_t chunksize;      /* bytes requested per ordinary chunk */
+};
+
+static chunk_t *new_chunk(mm_arena_t *arena, size_t size);
+
+/*
+ * mm_arena_create - create an empty arena whose chunks are chunksize
+ *     bytes (0 selects the default). Returns NULL if mm_malloc fails.
+ */
+mm_arena_t *mm_arena_create(size_t chunksize)
+{
+    mm_arena_t *arena;
+
+    if ((arena = mm_malloc(sizeof(mm_arena_t))) == NULL)
+	return NULL;
+
+    arena->first = NULL;
+    arena->cur = NULL;
+    arena->ptr = NULL;
+    arena->end = NULL;
+    arena->chunksize = (chunksize > 0) ? chunksize : ARENA_CHUNKSIZE;
+    return arena;
+}
+
+/*
+ * mm_arena_alloc - return an ALIGNMENT-aligned block of at least size
+ *     bytes that lives until the next reset or destroy of the arena.
+ */
+void *mm_arena_alloc(mm_arena_t *arena, size_t size)
+{
+    char *p;
+    chunk_t *next;
+
+    if (size == 0)
+	return NULL;
+    size = ARENA_ALIGN(size);
+
+    /* Fast path: bump within the current chunk */
+    if (size <= (size_t)(arena->end - arena->ptr)) {
+	p = arena->ptr;
+	arena->ptr += size;
+	return p;
+    }
+
+    /* Move on to the next retained chunk, or get a new one if it is too small */
+    next = (arena->cur != NULL) ? arena->cur->next : arena->first;
+    if (next == NULL || size > (size_t)(next->end - CHUNK_DATA(next))) {
+	if ((next = new_chunk(arena, size)) == NULL)
+	    return NULL;
+    }
+
+    arena->cur = next;
+    arena->ptr = CHUNK_DATA(next) + size;
+    arena->end = next->end;
+    return CHUNK_DATA(next);
+}
+
+/*
+ * mm_arena_reset - release every block allocated from the arena in
+ *     constant time. The chunks are retained and refilled from the first.
+ */
+void mm_arena_reset(mm_arena_t *arena)
+{
+    arena->cur = NULL;
+    arena->ptr = NULL;
+    arena->end = NULL;
+}
+
+/*
+ * mm_arena_destroy - return all chunks and the arena itself to the
+ *     mm package
+ */
+void mm_arena_destroy(mm_arena_t *arena)
+{
+    chunk_t *c;
+    chunk_t *cnext;
+
+    for (c = arena->first; c != NULL; c = cnext) {
+	cnext = c->next;
+	mm_free(c);
+    }
+    mm_free(arena);
+}
+
+/*
+ * new_chunk - get a chunk that can hold at least size bytes from
+ *     mm_malloc and link it in right after the current chunk, so that
+ *     it is the next one refilled after a reset as well
+ */
+static chunk_t *new_chunk(mm_arena_t *arena, size_t size)
+{
+    chunk_t *c;
+    size_t bytes = arena->chunksize;
+
+    if (bytes < CHUNK_HDRSIZE + size)
+	bytes = CHUNK_HDRSIZE + size;   /* oversized request gets its own chunk */
+
+    if ((c = mm_malloc(bytes)) == NULL)
+	return NULL;
+    c->end = (char *)c + bytes;
+
+    if (arena->cur == NULL) {
+	c->next = arena->first;
+	arena->first = c;
+    }
+    else {
+	c->next = arena->cur->next;
+	arena->cur->next = c;
+    }
+    return c;
+}
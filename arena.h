@@ -0,0 +1,11 @@
+/*
+ * arena.h - region (arena) allocation on top of the mm package
+ */
+#include <stddef.h>
+
+typedef struct mm_arena mm_arena_t;
+
+mm_arena_t *mm_arena_create(size_t chunksize);
+void *mm_arena_alloc(mm_arena_t *arena, size_t size);
+void mm_arena_reset(mm_arena_t *arena);
+void mm_arena_destroy(mm_arena_t *arena);
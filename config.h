@@ -45,6 +45,14 @@
  */
 #define AVG_LIBC_THRUPUT      600E3  /* 600 Kops/sec */
 
+/*
+ * If CALIBRATE_THRUPUT is set, the driver instead times libc malloc on
+ * the same traces at startup and uses its measured throughput as the
+ * cap, so that the index keeps meaning something on fast machines.
+ * AVG_LIBC_THRUPUT is then only used if the libc run fails.
+ */
+#define CALIBRATE_THRUPUT 1
+
  /* 
   * This constant determines the contributions of space utilization
   * (UTIL_WEIGHT) and throughput (1 - UTIL_WEIGHT) to the performance
@@ -52,6 +60,26 @@
   */
 #define UTIL_WEIGHT .60
 
+/*
+ * Share of the live blocks whose payloads mdriver -P reads after each
+ * request of a timed run, unless -P gives its own
+ */
+#define TOUCH_FRACTION .05
+
+/*
+ * Number of single timed runs per trace whose times mdriver -j records,
+ * so that mdcompare.pl can test two runs for a significant difference
+ */
+#define JSON_SAMPLES 15
+
+/*
+ * The correctness run checks the payloads of all live blocks whenever
+ * it has filled this many times their bytes since the last check. The
+ * checks then cost at most 1/SWEEP_RATIO of the fills; 0 checks the
+ * live blocks only as they are freed and at the end of the trace.
+ */
+#define SWEEP_RATIO 1
+
 /* 
  * Alignment requirement in bytes (either 4 or 8) 
  */
@@ -62,6 +90,28 @@
  */
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
 
+/*
+ * Maximum number of segments that memlib hands out apart from the
+ * break, once the break cannot grow (see mem_segment)
+ */
+#define MAX_SEGMENTS 256
+
+/*
+ * Maximum number of regions that memlib maps for large blocks (see
+ * mem_map_region). Regions count against MAX_HEAP like the break.
+ */
+#define MAX_REGIONS 1024
+
+/*
+ * If USE_HUGE_PAGES is set, memlib maps the simulated heap aligned to
+ * HUGE_PAGE_SIZE and asks the kernel to back it with huge pages
+ * (MAP_HUGETLB if pages are reserved, else MADV_HUGEPAGE), so that
+ * walks over a large heap do not miss in the TLB on every 4 KB page.
+ * Without kernel support the heap silently falls back to normal pages.
+ */
+#define USE_HUGE_PAGES 1
+#define HUGE_PAGE_SIZE (2*(1<<20))  /* 2 MB */
+
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
  *****************************************************************************/
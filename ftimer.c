@@ -7,9 +7,11 @@
  * Function timers that estimate the running time (in seconds) of a function f.
  *    ftimer_itimer: version that uses the interval timer
  *    ftimer_gettod: version that uses gettimeofday
+ *    ftimer_samples: times single runs with the monotonic clock
  */
 #include <stdio.h>
 #include <sys/time.h>
+#include <time.h>
 #include "ftimer.h"
 
 /* function prototypes */
@@ -52,6 +54,23 @@ double ftimer_gettod(ftimer_test_funct f, void *argp, int n)
     return (1E-3*diff);
 }
 
+/* 
+ * ftimer_samples - Use the monotonic clock to time n single runs of
+ * f(argp), and store their running times in samples[0..n-1].
+ */
+void ftimer_samples(ftimer_test_funct f, void *argp, int n, double *samples)
+{
+    int i;
+    struct timespec sts, ets;
+
+    for (i = 0; i < n; i++) {
+	clock_gettime(CLOCK_MONOTONIC, &sts);
+	f(argp);
+	clock_gettime(CLOCK_MONOTONIC, &ets);
+	samples[i] = (ets.tv_sec - sts.tv_sec) + 1E-9*(ets.tv_nsec - sts.tv_nsec);
+    }
+}
+
 
 /*
  * Routines for manipulating the Unix interval timer
@@ -0,0 +1,12 @@
+/*
+ * kernels.h - traces compiled into C functions by traces/trace2c.pl
+ */
+
+typedef struct {
+    char *name;        /* file name of the trace, without its directory */
+    int num_ops;       /* number of requests in the trace */
+    void (*run)(void); /* replays the trace on the mm package */
+} kernel_t;
+
+/* The kernels in kernels.c, terminated by an entry with a NULL name */
+extern kernel_t kernels[];
@@ -0,0 +1,231 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+use Getopt::Std;
+use JSON::PP;
+
+#######################################################################
+# mdcompare - test a run of mdriver against a baseline for regressions
+#
+# This script reads two result files written by mdriver -j, a baseline
+# and a new run, and compares them trace by trace. Utilization is
+# deterministic, so any drop of more than -u is a regression. The run
+# times are noisy, so the JSON_SAMPLES single run times of each trace
+# are compared with a two-sided Mann-Whitney U test: a trace regresses
+# if its times differ at significance level -a and its median
+# throughput dropped by more than -t. Both runs should come from the
+# same machine and mdriver options.
+#
+# Run times also vary from one mdriver process to the next (heap
+# placement, page backing, other load), which the samples of a single
+# run do not show. On a noisy machine, give each side as several
+# comma-separated result files: their samples are pooled.
+#
+# Exits with status 1 if any trace regressed, so that it can gate a
+# build.
+#
+#######################################################################
+
+$| = 1; # autoflush output on every print statement
+
+#
+# void usage(void) - print help message and terminate
+#
+sub usage
+{
+    printf STDERR "$_[0]\n";
+    printf STDERR "Usage: $0 [-h] [-a <alpha>] [-t <frac>] [-u <frac>]\n";
+    printf STDERR "       <baseline.json>[,...] <new.json>[,...]\n";
+    printf STDERR "Options:\n";
+    printf STDERR "  -h          Print this message\n";
+    printf STDERR "  -a <alpha>  Significance level of the U test (default 0.01)\n";
+    printf STDERR "  -t <frac>   Smallest throughput drop that counts (default 0.02)\n";
+    printf STDERR "  -u <frac>   Smallest util drop that counts (default 0.001)\n";
+    die "\n" ;
+}
+
+#
+# hash read_results(string files) - the results in a comma-separated
+# list of files from mdriver -j, with the samples of each trace pooled
+# into the first file's
+#
+sub read_results
+{
+    my ($first, $results, $file, $text, %traces, $trace);
+
+    foreach $file (split(",", $_[0])) {
+	open RESULTS, "<$file" or die "$0: ERROR: Cannot open $file\n";
+	$text = join("", <RESULTS>);
+	close RESULTS;
+	$results = decode_json($text);
+	if (!defined($first)) {
+	    $first = $results;
+	    %traces = map { $_->{name} => $_ } @{$first->{traces}};
+	    next;
+	}
+	foreach $trace (@{$results->{traces}}) {
+	    if ($traces{$trace->{name}} and $trace->{samples}) {
+		push @{$traces{$trace->{name}}{samples}}, @{$trace->{samples}};
+	    }
+	}
+    }
+    return $first;
+}
+
+#
+# double median(double list...) - the median of a list
+#
+sub median
+{
+    my @x = sort { $a <=> $b } @_;
+    my $n = @x;
+
+    return ($n % 2) ? $x[$n / 2] : ($x[$n / 2 - 1] + $x[$n / 2]) / 2;
+}
+
+#
+# double normal_tail(double z) - P(Z > z) for a standard normal Z, from
+# the erfc approximation 7.1.26 of Abramowitz and Stegun
+#
+sub normal_tail
+{
+    my $z = $_[0];
+    my $x = abs($z) / sqrt(2);
+    my $t = 1 / (1 + 0.3275911 * $x);
+    my $erfc = $t * (0.254829592 + $t * (-0.284496736 + $t * (1.421413741 +
+	$t * (-1.453152027 + $t * 1.061405429)))) * exp(-$x * $x);
+
+    return ($z >= 0) ? $erfc / 2 : 1 - $erfc / 2;
+}
+
+#
+# double mann_whitney(ref x, ref y) - the two-sided p-value of the
+# Mann-Whitney U test of samples x and y, by the normal approximation
+# with a tie correction and a continuity correction
+#
+sub mann_whitney
+{
+    my ($x, $y) = @_;
+    my $n1 = @$x;
+    my $n2 = @$y;
+    my $n = $n1 + $n2;
+    my @all = sort { $a->[0] <=> $b->[0] }
+	((map { [$_, 0] } @$x), (map { [$_, 1] } @$y));
+    my ($i, $j, $k, $rank, $r1, $ties, $u, $mean, $sigma, $z);
+
+    # Rank the pooled samples, giving ties their average rank
+    $r1 = 0;
+    $ties = 0;
+    for ($i = 0; $i < $n; $i = $j) {
+	for ($j = $i; $j < $n and $all[$j][0] == $all[$i][0]; $j++) {
+	}
+	$rank = ($i + 1 + $j) / 2;
+	for ($k = $i; $k < $j; $k++) {
+	    $r1 += $rank if ($all[$k][1] == 0);
+	}
+	$ties += ($j - $i) ** 3 - ($j - $i);
+    }
+
+    $u = $r1 - $n1 * ($n1 + 1) / 2;
+    $mean = $n1 * $n2 / 2;
+    $sigma = sqrt($n1 * $n2 / 12 * (($n + 1) - $ties / ($n * ($n - 1))));
+    if ($sigma == 0) {
+	return 1;
+    }
+    $z = (abs($u - $mean) - 0.5) / $sigma;
+    return ($z > 0) ? 2 * normal_tail($z) : 1;
+}
+
+##############
+# Main routine
+##############
+
+#
+# Parse and check the command line arguments
+#
+getopts('ha:t:u:');
+if ($opt_h) {
+    usage("");
+}
+$alpha = defined($opt_a) ? $opt_a : 0.01;
+$kops_drop = defined($opt_t) ? $opt_t : 0.02;
+$util_drop = defined($opt_u) ? $opt_u : 0.001;
+if (@ARGV != 2) {
+    usage("$0: ERROR: need a baseline and a new result file");
+}
+
+$base = read_results($ARGV[0]);
+$new = read_results($ARGV[1]);
+printf "baseline: %s %s %s\n", $base->{revision}, $base->{date}, $base->{command};
+printf "new:      %s %s %s\n", $new->{revision}, $new->{date}, $new->{command};
+if ($base->{command} ne $new->{command}) {
+    print "Warning: the runs used different mdriver options\n";
+}
+print "\n";
+
+%base_traces = map { $_->{name} => $_ } @{$base->{traces}};
+
+printf "%-20s%7s%7s%9s%9s%8s%9s  %s\n", "trace", "util", "util",
+    "Kops", "Kops", "change", "p", "";
+printf "%-20s%7s%7s%9s%9s%8s%9s\n", "", "base", "new", "base", "new", "", "";
+$regressions = 0;
+foreach $trace (@{$new->{traces}}) {
+    $name = $trace->{name};
+    $old = $base_traces{$name};
+    if (!defined($old)) {
+	printf "%-20s  not in the baseline\n", $name;
+	next;
+    }
+    if (!$trace->{valid} or !$old->{valid}) {
+	if ($old->{valid}) {
+	    printf "%-20s  REGRESSION: no longer valid\n", $name;
+	    $regressions++;
+	}
+	elsif ($trace->{valid}) {
+	    printf "%-20s  invalid in the baseline\n", $name;
+	}
+	else {
+	    printf "%-20s  invalid in both\n", $name;
+	}
+	next;
+    }
+
+    @verdict = ();
+    if ($trace->{util} < $old->{util} - $util_drop) {
+	push @verdict, "REGRESSION (util)";
+    }
+    elsif ($trace->{util} > $old->{util} + $util_drop) {
+	push @verdict, "better util";
+    }
+
+    # Throughput from the median single run time
+    if ($trace->{samples} and $old->{samples}) {
+	$old_kops = $old->{ops} / median(@{$old->{samples}}) / 1e3;
+	$new_kops = $trace->{ops} / median(@{$trace->{samples}}) / 1e3;
+	$change = $new_kops / $old_kops - 1;
+	$p = mann_whitney($old->{samples}, $trace->{samples});
+	if ($p < $alpha and $change < -$kops_drop) {
+	    push @verdict, "REGRESSION (Kops)";
+	}
+	elsif ($p < $alpha and $change > $kops_drop) {
+	    push @verdict, "faster";
+	}
+	printf "%-20s%6.1f%%%6.1f%%%9.0f%9.0f%7.1f%%%9.4f  %s\n", $name,
+	    100 * $old->{util}, 100 * $trace->{util}, $old_kops, $new_kops,
+	    100 * $change, $p, join(", ", @verdict);
+    }
+    else {
+	printf "%-20s%6.1f%%%6.1f%%%9s%9s%8s%9s  %s\n", $name,
+	    100 * $old->{util}, 100 * $trace->{util}, "-", "-", "-", "-",
+	    join(", ", @verdict);
+    }
+    $regressions += grep(/REGRESSION/, @verdict);
+}
+
+print "\n";
+printf "Perf index: %.1f -> %.1f\n", $base->{perfindex}, $new->{perfindex};
+if ($regressions) {
+    print "$regressions regressions\n";
+    exit 1;
+}
+print "No regressions\n";
+exit 0;
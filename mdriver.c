@@ -15,12 +15,41 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <malloc.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
 
 #include "mm.h"
+#include "arena.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "ftimer.h"
+#include "mtbench.h"
+#include "kernels.h"
+#include "pattern.h"
 #include "config.h"
 
+/*
+ * The extensions declared in mm.h are optional, so reference them
+ * weakly: a symbol the linked allocator does not define is NULL.
+ */
+#pragma weak mm_set_fit_policy
+#pragma weak mm_get_fit_stats
+#pragma weak mm_malloc_batch
+#pragma weak mm_free_batch
+#pragma weak mm_free_sized
+#pragma weak mm_set_tunable
+#pragma weak mm_halloc
+#pragma weak mm_hlock
+#pragma weak mm_hunlock
+#pragma weak mm_hfree
+#pragma weak mm_compact
+#pragma weak mm_malloc_hint
+#pragma weak mm_stats
+
 /**********************
  * Constants and macros
  **********************/
@@ -29,6 +58,19 @@
 #define MAXLINE     1024 /* max string size */
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
+#define MAXTUNABLES   16 /* max number of -T name=value settings */
+#define TOUCH_STRIDE  64 /* -P reads one payload byte per this many */
+#define LOC_LINE      64 /* cache line and page size for the locality... */
+#define LOC_PAGE    4096 /* ... stats of the util replays */
+#define LOC_SAMPLES   64 /* times per replay that the live set is measured */
+
+/* mallinfo2 replaces mallinfo (whose fields are ints) in glibc 2.33 */
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define HAVE_MALLINFO2 1
+#else
+#define HAVE_MALLINFO2 0
+#endif
 
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
@@ -46,11 +88,24 @@ typedef struct range_t {
 
 /* Characterizes a single trace operation (allocator request) */
 typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
+    enum {ALLOC, FREE, REALLOC, ARENA_ALLOC, ARENA_RESET, 
+	  HANDLE_ALLOC, HANDLE_FREE, COMPACT} type; /* type of request */
     int index;                        /* index for free() to use later */
+                                      /* (reset: first entry in reset_ids) */
     int size;                         /* byte size of alloc/realloc request */
+                                      /* (reset: number of ids released) */
+    int arena;                        /* arena of an arena alloc/reset */
+    int run;                          /* length of the run of same-size */
+                                      /* allocs (or of frees) starting here */
+    mm_hint_t hint;                   /* lifetime hint of an alloc */
 } traceop_t;
 
+/* A payload that -P reads after some request */
+typedef struct {
+    int index;           /* id of the live block */
+    int size;            /* ... and its payload size at that point */
+} touch_t;
+
 /* Holds the information for one trace file*/
 typedef struct {
     int sugg_heapsize;   /* suggested heap size (unused) */
@@ -60,8 +115,36 @@ typedef struct {
     traceop_t *ops;      /* array of requests */
     char **blocks;       /* array of ptrs returned by malloc/realloc... */
     size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+    int num_arenas;      /* number of arena ids used by A/R requests */
+    mm_arena_t **arenas; /* arenas, created on their first A request */
+    int *reset_ids;      /* ids released by each R request, in order */
+    int num_batches;     /* number of runs that -b replays as one batch... */
+    int batched_ops;     /* ... and the number of requests in those runs */
+    void **batch;        /* scratch array of ptrs for a batched request */
+    mm_handle_t *handles; /* handle of each live id allocated by h */
+    int *touch_start;    /* -P reads touches[touch_start[i]] up to... */
+    touch_t *touches;    /* ... touches[touch_start[i+1]] after request i */
+    int *live_ids;       /* ids of the live blocks of a valid run... */
+    int *live_slot;      /* ... and the slot of each id in it (-1: not live) */
+    int num_live;
+    size_t live_bytes;   /* payload bytes of the live blocks */
+    size_t filled_bytes; /* payload bytes filled since the last sweep */
 } trace_t;
 
+/* Gathers the spatial locality of a util replay (see locality_step) */
+typedef struct {
+    char *live;          /* is each id a live block that is measured? */
+    char *prev_lo;       /* extent of the previous allocation */
+    char *prev_hi;
+    unsigned long *dists; /* address distance of each allocation from the last */
+    int num_dists;
+    int same_line;       /* allocations sharing a cache line with the last... */
+    int same_page;       /* ... or a page */
+    unsigned long *pages; /* scratch: first and last page of each live block */
+    double spread;       /* sum of the live set's page spreads... */
+    int num_samples;     /* ... over this many samples */
+} locality_t;
+
 /* 
  * Holds the params to the xxx_speed functions, which are timed by fcyc. 
  * This struct is necessary because fcyc accepts only a pointer array
@@ -70,6 +153,7 @@ typedef struct {
 typedef struct {
     trace_t *trace;  
     range_t *ranges;
+    int batch;       /* replay runs with mm_malloc_batch/mm_free_batch */
 } speed_t;
 
 /* Summarizes the important stats for some malloc function on some trace */
@@ -79,8 +163,29 @@ typedef struct {
     int valid;       /* was the trace processed correctly by the allocator? */
     double secs;     /* number of secs needed to run the trace */
 
+    double util;     /* space utilization for this trace */
+    double dist;     /* median address distance of successive allocations */
+    double same_line; /* share of them on the same cache line... */
+    double same_page; /* ... or page */
+    double spread;   /* pages spanned by the live set / pages of payload */
+
+    /* defined only for libc malloc */
+    double usable;   /* malloc_usable_size / requested bytes at the peak */
+    double rss;      /* growth of the resident set (KB) during the trace */
+
     /* defined only for the student malloc package */
-    double util;     /* space utilization for this trace (always 0 for libc) */
+    fit_stats_t fit; /* find_fit search stats, if the allocator keeps them */
+    mm_stats_t alloc; /* mm_stats at the end of the util run... */
+    mm_stats_t alloc_peak; /* ... and when its heap last grew */
+    double batches;  /* number of batched runs replayed with -b */
+    double batch_secs; /* secs needed to run the trace with batching */
+    double kernel_secs; /* secs needed to run the trace's compiled kernel */
+    double remaps;   /* region growths by mremap in the util run... */
+    double remap_bytes; /* ... and the bytes they did not have to copy */
+    double heap_bytes; /* heap size at the end of a timed run... */
+    double huge_bytes; /* ... and how much of it is on huge pages */
+    double tlb_misses; /* dTLB load misses in one run (-1: no counter) */
+    double *samples;   /* JSON_SAMPLES single run times, for -j */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
@@ -95,6 +200,14 @@ char msg[MAXLINE];      /* for whenever we need to compose an error message */
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
 
+/* Payload access model of the timed runs, and its read share (-P) */
+static enum {TOUCH_NONE, TOUCH_RECENT, TOUCH_UNIFORM} touch_model = TOUCH_NONE;
+static double touch_fraction = TOUCH_FRACTION;
+static volatile unsigned int touch_sink; /* keeps the reads from being elided */
+
+/* Pass the traces' lifetime hints to mm_malloc_hint (cleared by -H) */
+static int use_hints = 1;
+
 /* The filenames of the default tracefiles */
 static char *default_tracefiles[] = {  
     DEFAULT_TRACEFILES, NULL
@@ -110,27 +223,71 @@ static int add_range(range_t **ranges, char *lo, int size,
 		     int tracenum, int opnum);
 static void remove_range(range_t **ranges, char *lo);
 static void clear_ranges(range_t **ranges);
+static int in_heap(char *lo, char *hi);
 
 /* These functions read, allocate, and free storage for traces */
 static trace_t *read_trace(char *tracedir, char *filename);
 static void free_trace(trace_t *trace);
 
+/* These functions plan and make the payload accesses of -P */
+static void plan_touches(trace_t *trace);
+static void touch_payloads(trace_t *trace, int lo, int hi);
+
+/* These functions fill and check the payloads of a valid run */
+static void payload_fill(trace_t *trace, int id, char *p, int size);
+static void payload_drop(trace_t *trace, int id);
+static int payload_check(trace_t *trace, int id, char *p, size_t size,
+			 int tracenum, int opnum, char *what);
+static int payload_sweep(trace_t *trace, int tracenum, int opnum);
+
+/* These functions measure the spatial locality of a util replay */
+static void locality_init(locality_t *loc, trace_t *trace);
+static void locality_step(locality_t *loc, trace_t *trace, int opnum);
+static void locality_finish(locality_t *loc, stats_t *stats);
+
+/* These functions manage the arenas used by a trace's A/R requests */
+static mm_arena_t *get_arena(trace_t *trace, int arena);
+static void destroy_arenas(trace_t *trace);
+
 /* Routines for evaluating the correctness and speed of libc malloc */
 static int eval_libc_valid(trace_t *trace, int tracenum);
+static double eval_libc_util(trace_t *trace, stats_t *stats);
 static void eval_libc_speed(void *ptr);
 
 /* Routines for evaluating correctnes, space utilization, and speed 
    of the student's malloc package in mm.c */
-static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
+static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges,
+			 int batch);
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges,
+			   stats_t *stats);
 static void eval_mm_speed(void *ptr);
 
+/* Routines for timing the traces compiled into kernels.c (-k) */
+static kernel_t *find_kernel(char *tracefile, int num_ops);
+static void eval_kernel_speed(void *ptr);
+
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printlibcstats(int n, stats_t *stats);
+static void printfitstats(int n, stats_t *stats);
+static void printallocstats(int n, stats_t *stats);
+static int have_alloc_stats(void);
+static void printremapstats(int n, stats_t *stats);
+static int have_remaps(int n, stats_t *stats);
+static unsigned long search_len_pct(mm_stats_t *alloc, double pct);
+static void printbatchresults(int n, stats_t *stats);
+static void printkernelresults(int n, stats_t *stats);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
 static void app_error(char *msg);
+static void libc_heap_info(size_t *system, size_t *inuse, size_t *mapped);
+static long rss_kbytes(void);
+static void printtlbstats(int n, stats_t *stats);
+static void write_json(char *file, char *command, char **tracefiles, int n,
+		       stats_t *stats, double perfindex, double max_throughput);
+static int tlb_counter_open(void);
+static double tlb_misses(int fd, speed_t *speed_params);
 
 /**************
  * Main routine
@@ -150,15 +307,43 @@ int main(int argc, char **argv)
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    char *fit_policy = NULL; /* If set, fit policy for mm_init (set by -p) */
+    int run_batch = 0;   /* If set, also time runs replayed as batches (-b) */
+    char *tunables[MAXTUNABLES]; /* name=value settings for mm_set_tunable */
+    int num_tunables = 0;  /* ... and their number (set by -T) */
+    double util_weight = UTIL_WEIGHT; /* weight of util in perfindex (-w) */
+    int mt_max_threads = 0;  /* If set, run the MT benchmarks up to -m threads */
+    int run_kernels = 0; /* If set, also time the compiled trace kernels (-k) */
+    char *touch_arg = NULL; /* If set, payload access model, as model[:frac] */
+    char *json_file = NULL; /* If set, write the results as JSON here (-j) */
+    long brk_limit = -1; /* If set, most bytes the break may cover (-s) */
+    char *command;       /* the command line, for the JSON results */
+    size_t len;
+    kernel_t *kernel;
+    char *fit_k, *value;
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
+    double libc_secs, libc_ops, max_throughput;
     int numcorrect;
+    int tlb_fd = -1;     /* dTLB miss counter, opened for -v */
     
+    /* Remember the command line, before -T and -P split their arguments */
+    for (i = 0, len = 1; i < argc; i++)
+	len += strlen(argv[i]) + 1;
+    if ((command = (char *)malloc(len)) == NULL)
+	unix_error("malloc failed in main");
+    command[0] = '\0';
+    for (i = 0; i < argc; i++) {
+	if (i > 0)
+	    strcat(command, " ");
+	strcat(command, argv[i]);
+    }
+
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:p:T:w:m:P:j:s:hvVgalbkH")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
@@ -178,12 +363,64 @@ int main(int argc, char **argv)
 	    if (tracedir[strlen(tracedir)-1] != '/') 
 		strcat(tracedir, "/"); /* path always ends with "/" */
 	    break;
+        case 'p': /* Fit policy for the mm package, as name[:k] */
+            fit_policy = optarg;
+            break;
+        case 'T': /* Tuning parameter for the mm package, as name=value */
+            if (num_tunables == MAXTUNABLES)
+		app_error("ERROR: too many -T settings");
+            tunables[num_tunables++] = optarg;
+            break;
+        case 'w': /* Weight of space utilization in the performance index */
+            util_weight = atof(optarg);
+            if (util_weight < 0 || util_weight > 1)
+		app_error("ERROR: the -w weight must be from 0 to 1");
+            break;
+        case 'm': /* Run the multi-threaded benchmarks at 1..n threads */
+            mt_max_threads = atoi(optarg);
+            if (mt_max_threads < 1)
+		app_error("ERROR: the -m thread count must be at least 1");
+            break;
+        case 'P': /* Touch payloads in the timed runs, as model[:fraction] */
+            touch_arg = strdup(optarg);
+            if ((value = strchr(optarg, ':')) != NULL) {
+		*value++ = '\0';
+		touch_fraction = atof(value);
+	    }
+            if (!strcmp(optarg, "recent"))
+		touch_model = TOUCH_RECENT;
+            else if (!strcmp(optarg, "uniform"))
+		touch_model = TOUCH_UNIFORM;
+            else {
+		sprintf(msg, "ERROR: unknown access model %s", optarg);
+		app_error(msg);
+	    }
+            if (touch_fraction < 0 || touch_fraction > 1)
+		app_error("ERROR: the -P fraction must be from 0 to 1");
+            break;
+        case 'j': /* Write the results as JSON to this file */
+            json_file = optarg;
+            break;
+        case 's': /* Limit the break, so that the heap grows in segments */
+            brk_limit = atol(optarg);
+            if (brk_limit < 0)
+		app_error("ERROR: the -s limit must not be negative");
+            break;
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'b': /* Also replay runs of allocs or frees as batches */
+            run_batch = 1;
+            break;
+        case 'H': /* Ignore the lifetime hints in the traces */
+            use_hints = 0;
+            break;
+        case 'k': /* Also time the traces compiled into kernels.c */
+            run_kernels = 1;
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -235,13 +472,26 @@ int main(int argc, char **argv)
 	printf("Using default tracefiles in %s\n", tracedir);
     }
 
+    /* 
+     * The kernels cannot touch payloads, and always pass the traces'
+     * hints, so with -P or -H their times would not compare
+     */
+    if (run_kernels && touch_model != TOUCH_NONE)
+	app_error("ERROR: -k cannot be combined with -P");
+    if (run_kernels && !use_hints)
+	app_error("ERROR: -k cannot be combined with -H");
+    if (touch_model != TOUCH_NONE)
+	printf("Touching payloads (-P %s): %.3g%% of the live blocks read "
+	       "after each request\n", touch_arg, 100*touch_fraction);
+
     /* Initialize the timing package */
     init_fsecs();
 
     /*
-     * Optionally run and evaluate the libc malloc package 
+     * Run and evaluate the libc malloc package if asked to, or if its
+     * throughput calibrates the performance index
      */
-    if (run_libc) {
+    if (run_libc || CALIBRATE_THRUPUT) {
 	if (verbose > 1)
 	    printf("\nTesting libc malloc\n");
 	
@@ -258,6 +508,9 @@ int main(int argc, char **argv)
 		printf("Checking libc malloc for correctness, ");
 	    libc_stats[i].valid = eval_libc_valid(trace, i);
 	    if (libc_stats[i].valid) {
+		if (verbose > 1)
+		    printf("efficiency, ");
+		libc_stats[i].util = eval_libc_util(trace, &libc_stats[i]);
 		speed_params.trace = trace;
 		if (verbose > 1)
 		    printf("and performance.\n");
@@ -267,9 +520,11 @@ int main(int argc, char **argv)
 	}
 
 	/* Display the libc results in a compact table */
-	if (verbose) {
+	if (run_libc && verbose) {
 	    printf("\nResults for libc malloc:\n");
 	    printresults(num_tracefiles, libc_stats);
+	    printf("\n");
+	    printlibcstats(num_tracefiles, libc_stats);
 	}
     }
 
@@ -284,25 +539,101 @@ int main(int argc, char **argv)
     if (mm_stats == NULL)
 	unix_error("mm_stats calloc in main failed");
     
+    /* Select the fit policy before the first mm_init */
+    if (fit_policy != NULL) {
+	if (mm_set_fit_policy == NULL)
+	    app_error("ERROR: this mm package does not support -p");
+	if ((fit_k = strchr(fit_policy, ':')) != NULL)
+	    *fit_k++ = '\0';
+	if (mm_set_fit_policy(fit_policy, fit_k ? atoi(fit_k) : 0) < 0) {
+	    sprintf(msg, "ERROR: unknown fit policy %s", fit_policy);
+	    app_error(msg);
+	}
+    }
+
+    /* Apply the tuning parameters before the first mm_init as well */
+    for (i = 0; i < num_tunables; i++) {
+	if (mm_set_tunable == NULL)
+	    app_error("ERROR: this mm package does not support -T");
+	if ((value = strchr(tunables[i], '=')) == NULL) {
+	    sprintf(msg, "ERROR: -T %s is not of the form name=value", tunables[i]);
+	    app_error(msg);
+	}
+	*value++ = '\0';
+	if (mm_set_tunable(tunables[i], atol(value)) < 0) {
+	    sprintf(msg, "ERROR: unknown tunable or bad value %s=%s", 
+		    tunables[i], value);
+	    app_error(msg);
+	}
+    }
+
+    if (run_batch && (mm_malloc_batch == NULL || mm_free_batch == NULL))
+	app_error("ERROR: this mm package does not support -b");
+
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
+    if (brk_limit >= 0)
+	mem_set_brk_limit(brk_limit);
+    if (verbose)
+	tlb_fd = tlb_counter_open();
 
     /* Evaluate student's mm malloc package using the K-best scheme */
     for (i=0; i < num_tracefiles; i++) {
 	trace = read_trace(tracedir, tracefiles[i]);
 	mm_stats[i].ops = trace->num_ops;
 	if (verbose > 1)
-	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
+	    printf("Checking mm_malloc for correctness (%s), ",
+		   pattern_isa());
+	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges, 0);
 	if (mm_stats[i].valid) {
 	    if (verbose > 1)
 		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    mm_stats[i].util = eval_mm_util(trace, i, &ranges, &mm_stats[i]);
+	    if (mm_get_fit_stats != NULL)
+		mm_get_fit_stats(&mm_stats[i].fit);
+	    mm_stats[i].remaps = mem_num_remaps();
+	    mm_stats[i].remap_bytes = mem_remapped_bytes();
 	    speed_params.trace = trace;
 	    speed_params.ranges = ranges;
+	    speed_params.batch = 0;
 	    if (verbose > 1)
 		printf("and performance.\n");
 	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+
+	    /* Time single runs too, for the distribution in the JSON */
+	    if (json_file != NULL) {
+		if ((mm_stats[i].samples = 
+		     (double *)malloc(JSON_SAMPLES * sizeof(double))) == NULL)
+		    unix_error("malloc failed in main");
+		ftimer_samples(eval_mm_speed, &speed_params, JSON_SAMPLES, 
+			       mm_stats[i].samples);
+	    }
+
+	    /* Count the dTLB misses of one more run, and its huge pages */
+	    if (verbose) {
+		mm_stats[i].tlb_misses = tlb_misses(tlb_fd, &speed_params);
+		mm_stats[i].heap_bytes = mem_heapsize();
+		mm_stats[i].huge_bytes = mem_hugepage_bytes();
+	    }
+
+	    /* Check and time the batched replay of the same trace */
+	    if (run_batch) {
+		if (verbose > 1)
+		    printf("Checking batched replay for correctness and performance.\n");
+		mm_stats[i].batches = trace->num_batches;
+		if (eval_mm_valid(trace, i, &ranges, 1)) {
+		    speed_params.batch = 1;
+		    mm_stats[i].batch_secs = fsecs(eval_mm_speed, &speed_params);
+		}
+	    }
+
+	    /* Time the same trace without the interpreter, if compiled */
+	    if (run_kernels && 
+		(kernel = find_kernel(tracefiles[i], trace->num_ops)) != NULL) {
+		if (verbose > 1)
+		    printf("Timing the compiled kernel.\n");
+		mm_stats[i].kernel_secs = fsecs(eval_kernel_speed, kernel);
+	    }
 	}
 	free_trace(trace);
     }
@@ -312,7 +643,31 @@ int main(int argc, char **argv)
 	printf("\nResults for mm malloc:\n");
 	printresults(num_tracefiles, mm_stats);
 	printf("\n");
+	if (mm_get_fit_stats != NULL) {
+	    printfitstats(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (have_alloc_stats()) {
+	    printallocstats(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (have_remaps(num_tracefiles, mm_stats)) {
+	    printremapstats(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (run_batch) {
+	    printbatchresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	if (run_kernels) {
+	    printkernelresults(num_tracefiles, mm_stats);
+	    printf("\n");
+	}
+	printtlbstats(num_tracefiles, mm_stats);
+	printf("\n");
     }
+    if (tlb_fd >= 0)
+	close(tlb_fd);
 
     /* 
      * Accumulate the aggregate statistics for the student's mm package 
@@ -330,19 +685,40 @@ int main(int argc, char **argv)
     }
     avg_mm_util = util/num_tracefiles;
 
+    /* 
+     * The throughput cap is the libc throughput on this machine if we
+     * measured it, and the reference AVG_LIBC_THRUPUT otherwise
+     */
+    max_throughput = AVG_LIBC_THRUPUT;
+    if (CALIBRATE_THRUPUT) {
+	libc_secs = 0;
+	libc_ops = 0;
+	for (i=0; i < num_tracefiles; i++) {
+	    if (libc_stats[i].valid) {
+		libc_secs += libc_stats[i].secs;
+		libc_ops += libc_stats[i].ops;
+	    }
+	}
+	if (libc_secs > 0)
+	    max_throughput = libc_ops/libc_secs;
+	if (verbose)
+	    printf("Throughput cap = %.0f Kops (libc, measured)\n", 
+		   max_throughput/1e3);
+    }
+
     /* 
      * Compute and print the performance index 
      */
     if (errors == 0) {
 	avg_mm_throughput = ops/secs;
 
-	p1 = UTIL_WEIGHT * avg_mm_util;
-	if (avg_mm_throughput > AVG_LIBC_THRUPUT) {
-	    p2 = (double)(1.0 - UTIL_WEIGHT);
+	p1 = util_weight * avg_mm_util;
+	if (avg_mm_throughput > max_throughput) {
+	    p2 = (double)(1.0 - util_weight);
 	} 
 	else {
-	    p2 = ((double) (1.0 - UTIL_WEIGHT)) * 
-		(avg_mm_throughput/AVG_LIBC_THRUPUT);
+	    p2 = ((double) (1.0 - util_weight)) * 
+		(avg_mm_throughput/max_throughput);
 	}
 	
 	perfindex = (p1 + p2)*100.0;
@@ -362,6 +738,16 @@ int main(int argc, char **argv)
 	printf("perfidx:%.0f\n", perfindex);
     }
 
+    if (json_file != NULL)
+	write_json(json_file, command, tracefiles, num_tracefiles, mm_stats,
+		   perfindex, max_throughput);
+
+    /* Run the multi-threaded benchmarks on a fresh heap */
+    if (mt_max_threads > 0) {
+	printf("\n");
+	mt_bench(mt_max_threads);
+    }
+
     exit(0);
 }
 
@@ -372,6 +758,26 @@ int main(int argc, char **argv)
  * range list to detect any overlapping allocated blocks.
  ****************************************************************/
 
+/*
+ * in_heap - Does the range lo..hi lie within the break's part of the
+ *     heap, or within one of the segments or regions that memlib
+ *     handed out?
+ */
+static int in_heap(char *lo, char *hi)
+{
+    int i;
+
+    if (lo >= (char *)mem_heap_lo() && hi <= (char *)mem_heap_hi())
+	return 1;
+    for (i = 0; i < mem_num_segments(); i++)
+	if (lo >= (char *)mem_segment_lo(i) && hi <= (char *)mem_segment_hi(i))
+	    return 1;
+    for (i = 0; i < mem_num_regions(); i++)
+	if (lo >= (char *)mem_region_lo(i) && hi <= (char *)mem_region_hi(i))
+	    return 1;
+    return 0;
+}
+
 /*
  * add_range - As directed by request opnum in trace tracenum,
  *     we've just called the student's mm_malloc to allocate a block of 
@@ -395,11 +801,11 @@ static int add_range(range_t **ranges, char *lo, int size,
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
-	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
-		lo, hi, mem_heap_lo(), mem_heap_hi());
+    /* The payload must lie within the heap, a segment or a region */
+    if (!in_heap(lo, hi)) {
+	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p), its %d segments and %d regions",
+		lo, hi, mem_heap_lo(), mem_heap_hi(), mem_num_segments(),
+		mem_num_regions());
 	malloc_error(tracenum, opnum, msg);
         return 0;
     }
@@ -477,9 +883,16 @@ static trace_t *read_trace(char *tracedir, char *filename)
     trace_t *trace;
     char type[MAXLINE];
     char path[MAXLINE];
-    unsigned index, size;
+    unsigned index, size, arena;
+    char hint[2];
     unsigned max_index = 0;
     unsigned op_index;
+    int *arena_head = NULL;   /* per arena: last id allocated since its reset */
+    int *arena_prev;          /* per id: previous id in the same arena */
+    int num_resets = 0;       /* entries used in trace->reset_ids */
+    char *is_handle;          /* per id: was it last allocated by h? */
+    int id;
+    int i, max_run;
 
     if (verbose > 1)
 	printf("Reading tracefile: %s\n", filename);
@@ -514,6 +927,18 @@ static trace_t *read_trace(char *tracedir, char *filename)
     if ((trace->block_sizes = 
 	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
 	unix_error("malloc 4 failed in read_trace");
+
+    /* Each id is released by at most one arena reset */
+    if ((trace->reset_ids = (int *)malloc(trace->num_ids * sizeof(int))) == NULL ||
+	(arena_prev = (int *)malloc(trace->num_ids * sizeof(int))) == NULL)
+	unix_error("malloc 5 failed in read_trace");
+    trace->num_arenas = 0;
+
+    /* Handle blocks are freed with mm_hfree, so tell their frees apart */
+    if ((trace->handles = 
+	 (mm_handle_t *)calloc(trace->num_ids, sizeof(mm_handle_t))) == NULL ||
+	(is_handle = (char *)calloc(trace->num_ids, 1)) == NULL)
+	unix_error("calloc failed in read_trace");
     
     /* read every request line in the trace file */
     index = 0;
@@ -525,7 +950,27 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	    trace->ops[op_index].type = ALLOC;
 	    trace->ops[op_index].index = index;
 	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].hint = MM_HINT_NONE;
+	    /* An optional lifetime hint follows on the same line */
+	    if (fscanf(tracefile, "%*[ \t]%1[slp]", hint) == 1 && 
+		use_hints && mm_malloc_hint != NULL)
+		trace->ops[op_index].hint = (hint[0] == 's') ? MM_HINT_SHORT :
+		    (hint[0] == 'l') ? MM_HINT_LONG : MM_HINT_PERMANENT;
+	    max_index = (index > max_index) ? index : max_index;
+	    is_handle[index] = 0;
+	    break;
+	case 'h':
+	    fscanf(tracefile, "%u %u", &index, &size);
+	    trace->ops[op_index].type = HANDLE_ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
 	    max_index = (index > max_index) ? index : max_index;
+	    is_handle[index] = 1;
+	    break;
+	case 'c':
+	    trace->ops[op_index].type = COMPACT;
+	    trace->ops[op_index].index = 0;
+	    trace->ops[op_index].size = 0;
 	    break;
 	case 'r':
 	    fscanf(tracefile, "%u %u", &index, &size);
@@ -536,9 +981,37 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	    break;
 	case 'f':
 	    fscanf(tracefile, "%ud", &index);
-	    trace->ops[op_index].type = FREE;
+	    trace->ops[op_index].type = is_handle[index] ? HANDLE_FREE : FREE;
 	    trace->ops[op_index].index = index;
 	    break;
+	case 'A':
+	    fscanf(tracefile, "%u %u %u", &arena, &index, &size);
+	    trace->ops[op_index].type = ARENA_ALLOC;
+	    trace->ops[op_index].arena = arena;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    if (arena >= trace->num_arenas) {
+		if ((arena_head = realloc(arena_head, (arena+1) * sizeof(int))) == NULL)
+		    unix_error("realloc failed in read_trace");
+		while (trace->num_arenas <= arena)
+		    arena_head[trace->num_arenas++] = -1;
+	    }
+	    arena_prev[index] = arena_head[arena];  /* remember for the reset */
+	    arena_head[arena] = index;
+	    break;
+	case 'R':
+	    fscanf(tracefile, "%u", &arena);
+	    trace->ops[op_index].type = ARENA_RESET;
+	    trace->ops[op_index].arena = arena;
+	    trace->ops[op_index].index = num_resets;
+	    if (arena < trace->num_arenas) {
+		for (id = arena_head[arena]; id >= 0; id = arena_prev[id])
+		    trace->reset_ids[num_resets++] = id;
+		arena_head[arena] = -1;
+	    }
+	    trace->ops[op_index].size = num_resets - trace->ops[op_index].index;
+	    break;
 	default:
 	    printf("Bogus type character (%c) in tracefile %s\n", 
 		   type[0], path);
@@ -550,12 +1023,58 @@ static trace_t *read_trace(char *tracedir, char *filename)
     fclose(tracefile);
     assert(max_index == trace->num_ids - 1);
     assert(trace->num_ops == op_index);
+
+    free(arena_head);
+    free(arena_prev);
+    free(is_handle);
+
+    /* 
+     * Find the runs of consecutive same-size allocs and of consecutive
+     * frees, which -b replays as single batched requests
+     */
+    max_run = 1;
+    for (i = trace->num_ops - 1; i >= 0; i--) {
+	trace->ops[i].run = 1;
+	if (i + 1 < trace->num_ops &&
+	    trace->ops[i+1].type == trace->ops[i].type &&
+	    ((trace->ops[i].type == ALLOC && 
+	      trace->ops[i].hint == MM_HINT_NONE &&
+	      trace->ops[i+1].hint == MM_HINT_NONE &&
+	      trace->ops[i+1].size == trace->ops[i].size) ||
+	     trace->ops[i].type == FREE))
+	    trace->ops[i].run = trace->ops[i+1].run + 1;
+	max_run = (trace->ops[i].run > max_run) ? trace->ops[i].run : max_run;
+    }
+    trace->num_batches = 0;
+    trace->batched_ops = 0;
+    for (i = 0; i < trace->num_ops; i += trace->ops[i].run) {
+	if (trace->ops[i].run > 1) {
+	    trace->num_batches++;
+	    trace->batched_ops += trace->ops[i].run;
+	}
+    }
+    if ((trace->batch = (void **)malloc(max_run * sizeof(void *))) == NULL)
+	unix_error("malloc 6 failed in read_trace");
+    if ((trace->arenas = (mm_arena_t **)calloc(trace->num_arenas + 1, 
+					       sizeof(mm_arena_t *))) == NULL)
+	unix_error("calloc failed in read_trace");
+
+    /* The valid runs keep a list of the live blocks for their sweeps */
+    if ((trace->live_ids = (int *)malloc(trace->num_ids * sizeof(int))) == NULL ||
+	(trace->live_slot = (int *)malloc(trace->num_ids * sizeof(int))) == NULL)
+	unix_error("malloc 7 failed in read_trace");
+
+    /* Plan the payload accesses of the timed runs */
+    trace->touch_start = NULL;
+    trace->touches = NULL;
+    if (touch_model != TOUCH_NONE)
+	plan_touches(trace);
     
     return trace;
 }
 
 /*
- * free_trace - Free the trace record and the three arrays it points
+ * free_trace - Free the trace record and the arrays it points
  *              to, all of which were allocated in read_trace().
  */
 void free_trace(trace_t *trace)
@@ -563,30 +1082,364 @@ void free_trace(trace_t *trace)
     free(trace->ops);         /* free the three arrays... */
     free(trace->blocks);      
     free(trace->block_sizes);
+    free(trace->arenas);      /* ... and the arena bookkeeping */
+    free(trace->reset_ids);
+    free(trace->batch);
+    free(trace->handles);
+    free(trace->touch_start); /* ... the payload accesses of -P */
+    free(trace->touches);
+    free(trace->live_ids);    /* ... the live list of the valid runs */
+    free(trace->live_slot);
     free(trace);              /* and the trace record itself... */
 }
 
+/*
+ * plan_touches - Plans which payloads -P reads after each request of a
+ *     trace. On average touch_fraction of the live blocks are read (the
+ *     fraction of a block left over carries to the next request),
+ *     picked by the access model: the most recently allocated or
+ *     reallocated blocks first (recent), or uniformly at random, with
+ *     a fixed seed (uniform). Only malloc'd and arena blocks are read,
+ *     since handle blocks may move. Planning before the timed runs
+ *     keeps the bookkeeping out of them.
+ */
+static void plan_touches(trace_t *trace)
+{
+    int i, j, k, id, count, *first;
+    int num_live = 0, num_touches = 0, max_touches = trace->num_ops;
+    int *live, *pos, *older, *newer, *sizes;
+    int newest = -1;
+    unsigned int seed = 1;
+    double credit = 0;
+
+    /* live blocks in any order (with each one's position in it)... */
+    if ((live = (int *)malloc(trace->num_ids * sizeof(int))) == NULL ||
+	(pos = (int *)malloc(trace->num_ids * sizeof(int))) == NULL ||
+	/* ... and from the newest to the oldest, with their sizes */
+	(older = (int *)malloc(trace->num_ids * sizeof(int))) == NULL ||
+	(newer = (int *)malloc(trace->num_ids * sizeof(int))) == NULL ||
+	(sizes = (int *)malloc(trace->num_ids * sizeof(int))) == NULL)
+	unix_error("malloc 1 failed in plan_touches");
+    if ((trace->touch_start = 
+	 (int *)malloc((trace->num_ops + 1) * sizeof(int))) == NULL ||
+	(trace->touches = 
+	 (touch_t *)malloc(max_touches * sizeof(touch_t))) == NULL)
+	unix_error("malloc 2 failed in plan_touches");
+    for (id = 0; id < trace->num_ids; id++)
+	pos[id] = -1;
+
+    for (i = 0; i < trace->num_ops; i++) {
+	/* Find the block that the request makes the newest... */
+	id = -1;
+	first = NULL;
+	count = 0;
+	switch (trace->ops[i].type) {
+	case ALLOC:
+	case REALLOC:
+	case ARENA_ALLOC:
+	    id = trace->ops[i].index;
+	    sizes[id] = trace->ops[i].size;
+	    break;
+	/* ... or the blocks that it frees */
+	case FREE:
+	    first = &trace->ops[i].index;
+	    count = 1;
+	    break;
+	case ARENA_RESET:
+	    first = &trace->reset_ids[trace->ops[i].index];
+	    count = trace->ops[i].size;
+	    break;
+	default:
+	    break;
+	}
+
+	/* Unlink a reallocated or freed block from the recency list... */
+	for (j = (id >= 0) ? -1 : 0; j < count; j++) {
+	    k = (j < 0) ? id : first[j];
+	    if (pos[k] < 0)
+		continue;
+	    if (older[k] >= 0)
+		newer[older[k]] = newer[k];
+	    if (newer[k] >= 0)
+		older[newer[k]] = older[k];
+	    else
+		newest = older[k];
+	    /* ... and drop a freed one from the live blocks */
+	    if (j >= 0) {
+		live[pos[k]] = live[--num_live];
+		pos[live[pos[k]]] = pos[k];
+		pos[k] = -1;
+	    }
+	}
+
+	/* Make an allocated or reallocated block the newest */
+	if (id >= 0) {
+	    if (pos[id] < 0) {
+		pos[id] = num_live;
+		live[num_live++] = id;
+	    }
+	    older[id] = newest;
+	    newer[id] = -1;
+	    if (newest >= 0)
+		newer[newest] = id;
+	    newest = id;
+	}
+
+	/* Pick the blocks to read after this request */
+	trace->touch_start[i] = num_touches;
+	credit += touch_fraction * num_live;
+	k = (int)credit;
+	credit -= k;
+	if (num_touches + k > max_touches) {
+	    max_touches = 2 * (num_touches + k);
+	    if ((trace->touches = (touch_t *)realloc(trace->touches, 
+				max_touches * sizeof(touch_t))) == NULL)
+		unix_error("realloc failed in plan_touches");
+	}
+	for (j = 0, id = newest; j < k; j++) {
+	    if (touch_model == TOUCH_RECENT) {
+		trace->touches[num_touches].index = id;
+		id = older[id];
+	    }
+	    else {
+		seed = seed * 1103515245 + 12345;
+		trace->touches[num_touches].index = live[(seed >> 16) % num_live];
+	    }
+	    trace->touches[num_touches].size = 
+		sizes[trace->touches[num_touches].index];
+	    num_touches++;
+	}
+    }
+    trace->touch_start[trace->num_ops] = num_touches;
+
+    free(live);
+    free(pos);
+    free(older);
+    free(newer);
+    free(sizes);
+}
+
+/*
+ * touch_payloads - Makes the payload accesses of -P that follow
+ *     requests lo..hi-1 of a timed run: writes each payload that they
+ *     allocated or reallocated, then reads the planned payloads, one
+ *     byte every TOUCH_STRIDE bytes. The time is charged to the
+ *     allocator, whose placement decides how well they cache.
+ */
+static void touch_payloads(trace_t *trace, int lo, int hi)
+{
+    int i, j, off, size;
+    unsigned int sum = 0;
+    char *p;
+
+    for (i = lo; i < hi; i++) {
+	if (trace->ops[i].type == ALLOC || trace->ops[i].type == REALLOC ||
+	    trace->ops[i].type == ARENA_ALLOC)
+	    memset(trace->blocks[trace->ops[i].index], i, trace->ops[i].size);
+	for (j = trace->touch_start[i]; j < trace->touch_start[i+1]; j++) {
+	    p = trace->blocks[trace->touches[j].index];
+	    size = trace->touches[j].size;
+	    for (off = 0; off < size; off += TOUCH_STRIDE)
+		sum += p[off];
+	}
+    }
+    touch_sink += sum;
+}
+
+/*
+ * locality_init - Starts gathering the locality of a util replay
+ */
+static void locality_init(locality_t *loc, trace_t *trace)
+{
+    if ((loc->live = (char *)calloc(trace->num_ids, 1)) == NULL ||
+	(loc->dists = (unsigned long *)malloc(trace->num_ops * 
+					      sizeof(unsigned long))) == NULL ||
+	(loc->pages = (unsigned long *)malloc(2 * trace->num_ids * 
+					      sizeof(unsigned long))) == NULL)
+	unix_error("malloc failed in locality_init");
+    loc->prev_lo = loc->prev_hi = NULL;
+    loc->num_dists = 0;
+    loc->same_line = 0;
+    loc->same_page = 0;
+    loc->spread = 0;
+    loc->num_samples = 0;
+}
+
+/*
+ * compare_ulongs - qsort comparison of unsigned longs (pairs of pages
+ *     sort by their first page)
+ */
+static int compare_ulongs(const void *a, const void *b)
+{
+    unsigned long x = *(unsigned long *)a, y = *(unsigned long *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * locality_step - Accounts for request opnum of a util replay, after
+ *     the replay has updated trace->blocks and trace->block_sizes.
+ *     Each allocation (malloc, realloc or arena) is compared with the
+ *     previous one: the distance between their addresses, and whether
+ *     they share a cache line or a page. LOC_SAMPLES times per replay,
+ *     the live set's page spread is measured: the pages that the live
+ *     payloads touch, over the pages that they would fill if packed.
+ *     Handle blocks are left out, since they may move.
+ */
+static void locality_step(locality_t *loc, trace_t *trace, int opnum)
+{
+    int i, id, n;
+    char *lo, *hi;
+    unsigned long pages, last, bytes;
+
+    id = trace->ops[opnum].index;
+    switch (trace->ops[opnum].type) {
+    case ALLOC:
+    case REALLOC:
+    case ARENA_ALLOC:
+	lo = trace->blocks[id];
+	hi = lo + (trace->block_sizes[id] ? trace->block_sizes[id] : 1);
+	if (loc->prev_lo != NULL) {
+	    loc->dists[loc->num_dists++] = (lo > loc->prev_lo) ? 
+		lo - loc->prev_lo : loc->prev_lo - lo;
+	    if ((unsigned long)lo / LOC_LINE <= 
+		(unsigned long)(loc->prev_hi - 1) / LOC_LINE &&
+		(unsigned long)loc->prev_lo / LOC_LINE <= 
+		(unsigned long)(hi - 1) / LOC_LINE)
+		loc->same_line++;
+	    if ((unsigned long)lo / LOC_PAGE <= 
+		(unsigned long)(loc->prev_hi - 1) / LOC_PAGE &&
+		(unsigned long)loc->prev_lo / LOC_PAGE <= 
+		(unsigned long)(hi - 1) / LOC_PAGE)
+		loc->same_page++;
+	}
+	loc->prev_lo = lo;
+	loc->prev_hi = hi;
+	loc->live[id] = 1;
+	break;
+    case FREE:
+	loc->live[id] = 0;
+	break;
+    case ARENA_RESET:
+	for (i = id; i < id + trace->ops[opnum].size; i++)
+	    loc->live[trace->reset_ids[i]] = 0;
+	break;
+    default:
+	break;
+    }
+
+    /* Measure the page spread of the live set now and then */
+    if (opnum % (trace->num_ops / LOC_SAMPLES + 1) != 0)
+	return;
+    n = 0;
+    bytes = 0;
+    for (id = 0; id < trace->num_ids; id++) {
+	if (!loc->live[id] || trace->block_sizes[id] == 0)
+	    continue;
+	lo = trace->blocks[id];
+	loc->pages[2*n] = (unsigned long)lo / LOC_PAGE;
+	loc->pages[2*n+1] = (unsigned long)(lo + trace->block_sizes[id] - 1) /
+	    LOC_PAGE;
+	bytes += trace->block_sizes[id];
+	n++;
+    }
+    if (n == 0)
+	return;
+    qsort(loc->pages, n, 2 * sizeof(unsigned long), compare_ulongs);
+    pages = 0;
+    last = 0;
+    for (i = 0; i < n; i++) {
+	if (pages == 0 || loc->pages[2*i] > last)
+	    pages += loc->pages[2*i+1] - loc->pages[2*i] + 1;
+	else if (loc->pages[2*i+1] > last)
+	    pages += loc->pages[2*i+1] - last;
+	else
+	    continue;
+	last = loc->pages[2*i+1];
+    }
+    loc->spread += (double)pages / ((bytes + LOC_PAGE - 1) / LOC_PAGE);
+    loc->num_samples++;
+}
+
+/*
+ * locality_finish - Stores the locality of a util replay in stats
+ */
+static void locality_finish(locality_t *loc, stats_t *stats)
+{
+    stats->dist = 0;
+    stats->same_line = 0;
+    stats->same_page = 0;
+    stats->spread = loc->num_samples ? loc->spread / loc->num_samples : 0;
+    if (loc->num_dists > 0) {
+	qsort(loc->dists, loc->num_dists, sizeof(unsigned long), compare_ulongs);
+	stats->dist = loc->dists[loc->num_dists / 2];
+	stats->same_line = (double)loc->same_line / loc->num_dists;
+	stats->same_page = (double)loc->same_page / loc->num_dists;
+    }
+    free(loc->live);
+    free(loc->dists);
+    free(loc->pages);
+}
+
+/*
+ * get_arena - Return the arena for A requests naming arena, creating
+ *     it on first use. Returns NULL if mm_arena_create fails.
+ */
+static mm_arena_t *get_arena(trace_t *trace, int arena)
+{
+    if (trace->arenas[arena] == NULL)
+	trace->arenas[arena] = mm_arena_create(0);
+    return trace->arenas[arena];
+}
+
+/*
+ * destroy_arenas - Return the arenas created for this run of the
+ *     trace to the mm package and forget them
+ */
+static void destroy_arenas(trace_t *trace)
+{
+    int i;
+
+    for (i = 0; i < trace->num_arenas; i++) {
+	if (trace->arenas[i] != NULL)
+	    mm_arena_destroy(trace->arenas[i]);
+	trace->arenas[i] = NULL;
+    }
+}
+
 /**********************************************************************
  * The following functions evaluate the correctness, space utilization,
  * and throughput of the libc and mm malloc packages.
  **********************************************************************/
 
 /*
- * eval_mm_valid - Check the mm malloc package for correctness
+ * eval_mm_valid - Check the mm malloc package for correctness. If
+ *     batch is set, runs of same-size allocs and of frees are replayed
+ *     with mm_malloc_batch and mm_free_batch.
  */
-static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
+static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges,
+			 int batch) 
 {
-    int i, j;
+    int i, j, n;
     int index;
     int size;
     int oldsize;
     char *newp;
     char *oldp;
     char *p;
+    mm_arena_t *arena;
+    mm_handle_t h;
     
     /* Reset the heap and free any records in the range list */
     mem_reset_brk();
     clear_ranges(ranges);
+    memset(trace->arenas, 0, trace->num_arenas * sizeof(mm_arena_t *));
+    memset(trace->handles, 0, trace->num_ids * sizeof(mm_handle_t));
+    for (j = 0; j < trace->num_ids; j++)
+	trace->live_slot[j] = -1;
+    trace->num_live = 0;
+    trace->live_bytes = 0;
+    trace->filled_bytes = 0;
 
     /* Call the mm package's init function */
     if (mm_init() < 0) {
@@ -599,12 +1452,57 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	index = trace->ops[i].index;
 	size = trace->ops[i].size;
 
+	/* 
+	 * Check every live payload once the fills since the last sweep
+	 * add up to SWEEP_RATIO times the live bytes, so that the sweeps
+	 * cost at most 1/SWEEP_RATIO of the fills
+	 */
+	if (SWEEP_RATIO > 0 && 
+	    trace->filled_bytes >= SWEEP_RATIO * trace->live_bytes &&
+	    payload_sweep(trace, tracenum, i) == 0)
+	    return 0;
+
+	if (batch && trace->ops[i].run > 1) {
+	    n = trace->ops[i].run;
+	    if (trace->ops[i].type == ALLOC) {
+		if (mm_malloc_batch(n, size, trace->batch) < n) {
+		    malloc_error(tracenum, i, "mm_malloc_batch failed.");
+		    return 0;
+		}
+		/* Check and fill each block just like a single mm_malloc */
+		for (j = 0; j < n; j++) {
+		    index = trace->ops[i+j].index;
+		    p = trace->batch[j];
+		    if (add_range(ranges, p, size, tracenum, i+j) == 0)
+			return 0;
+		    payload_fill(trace, index, p, size);
+		}
+	    }
+	    else {
+		for (j = 0; j < n; j++) {
+		    index = trace->ops[i+j].index;
+		    p = trace->blocks[index];
+		    if (payload_check(trace, index, p, trace->block_sizes[index],
+				      tracenum, i+j, "freed block") == 0)
+			return 0;
+		    payload_drop(trace, index);
+		    remove_range(ranges, p);
+		    trace->batch[j] = p;
+		}
+		mm_free_batch(n, trace->batch);
+	    }
+	    i += n - 1;
+	    continue;
+	}
+
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    if ((p = (trace->ops[i].hint != MM_HINT_NONE) ? 
+		 mm_malloc_hint(size, trace->ops[i].hint) : 
+		 mm_malloc(size)) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -618,15 +1516,11 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 		return 0;
 	    
 	    /* ADDED: cgw
-	     * fill range with low byte of index.  This will be used later
+	     * fill range with the pattern of index.  This will be used later
 	     * if we realloc the block and wish to make sure that the old
-	     * data was copied to the new block
+	     * data was copied to the new block, and by the sweeps
 	     */
-	    memset(p, index & 0xFF, size);
-
-	    /* Remember region */
-	    trace->blocks[index] = p;
-	    trace->block_sizes[index] = size;
+	    payload_fill(trace, index, p, size);
 	    break;
 
         case REALLOC: /* mm_realloc */
@@ -647,31 +1541,147 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* ADDED: cgw
 	     * Make sure that the new block contains the data from the old 
-	     * block and then fill in the new block with the low order byte
-	     * of the new index
+	     * block and then fill in the new block with the pattern of
+	     * the index
 	     */
 	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
-	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
-		malloc_error(tracenum, i, "mm_realloc did not preserve the "
-			     "data from old block");
+	    if (payload_check(trace, index, newp, oldsize, tracenum, i,
+			      "mm_realloc did not preserve the data from "
+			      "old block") == 0)
 		return 0;
-	      }
-	    }
-	    memset(newp, index & 0xFF, size);
-
-	    /* Remember region */
-	    trace->blocks[index] = newp;
-	    trace->block_sizes[index] = size;
+	    payload_fill(trace, index, newp, size);
 	    break;
 
         case FREE: /* mm_free */
 	    
-	    /* Remove region from list and call student's free function */
+	    /* 
+	     * Check that nothing overwrote the block while it was live,
+	     * then remove region from list and call student's free function
+	     */
 	    p = trace->blocks[index];
+	    if (payload_check(trace, index, p, trace->block_sizes[index],
+			      tracenum, i, "freed block") == 0)
+		return 0;
+	    payload_drop(trace, index);
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    if (mm_free_sized != NULL)
+		mm_free_sized(p, trace->block_sizes[index]);
+	    else
+		mm_free(p);
+	    break;
+
+        case ARENA_ALLOC: /* mm_arena_alloc */
+
+	    if ((arena = get_arena(trace, trace->ops[i].arena)) == NULL) {
+		malloc_error(tracenum, i, "mm_arena_create failed.");
+		return 0;
+	    }
+	    if ((p = mm_arena_alloc(arena, size)) == NULL) {
+		malloc_error(tracenum, i, "mm_arena_alloc failed.");
+		return 0;
+	    }
+
+	    /* Same checks and fill pattern as an ordinary allocation */
+	    if (add_range(ranges, p, size, tracenum, i) == 0)
+		return 0;
+	    payload_fill(trace, index, p, size);
+	    break;
+
+        case ARENA_RESET: /* mm_arena_reset */
+
+	    /* 
+	     * Every block released by the reset must still hold its fill
+	     * pattern, i.e., nothing else in the heap overwrote it
+	     */
+	    for (j = index; j < index + size; j++) {
+		p = trace->blocks[trace->reset_ids[j]];
+		if (payload_check(trace, trace->reset_ids[j], p,
+				  trace->block_sizes[trace->reset_ids[j]],
+				  tracenum, i, "arena block before its reset") == 0)
+		    return 0;
+		payload_drop(trace, trace->reset_ids[j]);
+		remove_range(ranges, p);
+	    }
+	    if (trace->arenas[trace->ops[i].arena] != NULL)
+		mm_arena_reset(trace->arenas[trace->ops[i].arena]);
+	    break;
+
+        case HANDLE_ALLOC: /* mm_halloc */
+
+	    if (mm_halloc == NULL || mm_hlock == NULL || mm_hunlock == NULL) {
+		malloc_error(tracenum, i, "this mm package has no handle API.");
+		return 0;
+	    }
+	    if ((h = mm_halloc(size)) == 0) {
+		malloc_error(tracenum, i, "mm_halloc failed.");
+		return 0;
+	    }
+
+	    /* The block stays at this address until the next compaction */
+	    p = mm_hlock(h);
+	    mm_hunlock(h);
+	    if (add_range(ranges, p, size, tracenum, i) == 0)
+		return 0;
+	    payload_fill(trace, index, p, size);
+	    trace->handles[index] = h;
+	    break;
+
+        case HANDLE_FREE: /* mm_hfree */
+
+	    if (payload_check(trace, index, trace->blocks[index],
+			      trace->block_sizes[index], tracenum, i,
+			      "freed handle block") == 0)
+		return 0;
+	    payload_drop(trace, index);
+	    remove_range(ranges, trace->blocks[index]);
+	    mm_hfree(trace->handles[index]);
+	    trace->handles[index] = 0;
+	    break;
+
+        case COMPACT: /* mm_compact */
+
+	    if (mm_compact == NULL) {
+		malloc_error(tracenum, i, "this mm package has no mm_compact.");
+		return 0;
+	    }
+
+	    /* 
+	     * Pin every fourth live handle block, which must then stay
+	     * put, and take all of them out of the range list, since
+	     * the others may move on top of each other's old ranges
+	     */
+	    for (j = 0; j < trace->num_ids; j++) {
+		if ((h = trace->handles[j]) == 0)
+		    continue;
+		if (j % 4 == 0)
+		    mm_hlock(h);
+		remove_range(ranges, trace->blocks[j]);
+	    }
+
+	    mm_compact();
+
+	    /* Check where each handle block ended up, and its data */
+	    for (j = 0; j < trace->num_ids; j++) {
+		if ((h = trace->handles[j]) == 0)
+		    continue;
+		p = mm_hlock(h);
+		mm_hunlock(h);
+		if (j % 4 == 0) {
+		    mm_hunlock(h);
+		    if (p != trace->blocks[j]) {
+			malloc_error(tracenum, i, "mm_compact moved a pinned block");
+			return 0;
+		    }
+		}
+		if (add_range(ranges, p, trace->block_sizes[j], tracenum, i) == 0)
+		    return 0;
+		if (payload_check(trace, j, p, trace->block_sizes[j], tracenum, i,
+				  "mm_compact did not preserve the data of a "
+				  "handle block") == 0)
+		    return 0;
+		trace->blocks[j] = p;
+	    }
 	    break;
 
 	default:
@@ -680,44 +1690,137 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 
     }
 
+    /* A last sweep over the blocks that the trace leaves live */
+    if (payload_sweep(trace, tracenum, trace->num_ops - 1) == 0)
+	return 0;
+
     /* As far as we know, this is a valid malloc package */
+    destroy_arenas(trace);
     return 1;
 }
 
-/* 
- * eval_mm_util - Evaluate the space utilization of the student's package
- *   The idea is to remember the high water mark "hwm" of the heap for 
- *   an optimal allocator, i.e., no gaps and no internal fragmentation.
- *   Utilization is the ratio hwm/heapsize, where heapsize is the 
- *   size of the heap in bytes after running the student's malloc 
- *   package on the trace. Note that our implementation of mem_sbrk() 
- *   doesn't allow the students to decrement the brk pointer, so brk
- *   is always the high water mark of the heap. 
- *   
+/*
+ * payload_fill - Fill the payload of block id, just allocated or
+ *     reallocated at p, with the block's pattern, and remember it as
+ *     live
  */
-static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
-{   
-    int i;
-    int index;
-    int size, newsize, oldsize;
-    int max_total_size = 0;
-    int total_size = 0;
-    char *p;
-    char *newp, *oldp;
+static void payload_fill(trace_t *trace, int id, char *p, int size)
+{
+    pattern_fill(p, size, pattern_of(id));
+    trace->filled_bytes += size;
 
-    /* initialize the heap and the mm malloc package */
-    mem_reset_brk();
-    if (mm_init() < 0)
-	app_error("mm_init failed in eval_mm_util");
+    /* A realloc'ed block is already in the live list */
+    if (trace->live_slot[id] >= 0)
+	trace->live_bytes -= trace->block_sizes[id];
+    else {
+	trace->live_slot[id] = trace->num_live;
+	trace->live_ids[trace->num_live++] = id;
+    }
+    trace->live_bytes += size;
+    trace->blocks[id] = p;
+    trace->block_sizes[id] = size;
+}
 
-    for (i = 0;  i < trace->num_ops;  i++) {
+/*
+ * payload_drop - Take block id, about to be freed, off the live list
+ */
+static void payload_drop(trace_t *trace, int id)
+{
+    int slot = trace->live_slot[id];
+    int last = trace->live_ids[--trace->num_live];
+
+    trace->live_ids[slot] = last;
+    trace->live_slot[last] = slot;
+    trace->live_slot[id] = -1;
+    trace->live_bytes -= trace->block_sizes[id];
+}
+
+/*
+ * payload_check - Check that the first size bytes at p still hold the
+ *     pattern of block id. If not, report what was found at request
+ *     opnum and return 0.
+ */
+static int payload_check(trace_t *trace, int id, char *p, size_t size,
+			 int tracenum, int opnum, char *what)
+{
+    size_t bad = pattern_check(p, size, pattern_of(id));
+    char msg[MAXLINE];
+
+    if (bad == size)
+	return 1;
+    sprintf(msg, "%s: payload of block %d (%p:%p) overwritten at byte %lu",
+	    what, id, p, p + trace->block_sizes[id] - 1, (unsigned long)bad);
+    malloc_error(tracenum, opnum, msg);
+    return 0;
+}
+
+/*
+ * payload_sweep - Check the payloads of all live blocks before request
+ *     opnum, to catch a block that the allocator overwrote long before
+ *     the block is freed
+ */
+static int payload_sweep(trace_t *trace, int tracenum, int opnum)
+{
+    int j, id;
+
+    for (j = 0; j < trace->num_live; j++) {
+	id = trace->live_ids[j];
+	if (payload_check(trace, id, trace->blocks[id], trace->block_sizes[id],
+			  tracenum, opnum, "sweep") == 0)
+	    return 0;
+    }
+    trace->filled_bytes = 0;
+    return 1;
+}
+
+/* 
+ * eval_mm_util - Evaluate the space utilization of the student's package
+ *   The idea is to remember the high water mark "hwm" of the heap for 
+ *   an optimal allocator, i.e., no gaps and no internal fragmentation.
+ *   Utilization is the ratio hwm/heapsize, where heapsize is the 
+ *   size of the heap in bytes after running the student's malloc 
+ *   package on the trace. The replay also gathers the allocation
+ *   locality stats (see locality_step).
+ *
+ *   mem_sbrk() lets a compacting package lower the brk pointer, so
+ *   the heap high water mark is tracked after every request. A
+ *   compaction request starts both high water marks over from the
+ *   post-compaction heap and payload, so that the utilization of a
+ *   trace that compacts is that of the heap after its last compaction.
+ */
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges,
+			   stats_t *stats)
+{   
+    int i;
+    int index;
+    int size, newsize, oldsize;
+    int max_total_size = 0;
+    int total_size = 0;
+    size_t max_heap_size = 0;
+    int j;
+    char *p;
+    char *newp, *oldp;
+    mm_arena_t *arena;
+    locality_t loc;
+
+    /* initialize the heap and the mm malloc package */
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_util");
+    memset(trace->arenas, 0, trace->num_arenas * sizeof(mm_arena_t *));
+    memset(trace->handles, 0, trace->num_ids * sizeof(mm_handle_t));
+    locality_init(&loc, trace);
+
+    for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_alloc */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if ((p = (trace->ops[i].hint != MM_HINT_NONE) ? 
+		 mm_malloc_hint(size, trace->ops[i].hint) : 
+		 mm_malloc(size)) == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -760,7 +1863,10 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    if (mm_free_sized != NULL)
+		mm_free_sized(p, size);
+	    else
+		mm_free(p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -768,13 +1874,74 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    break;
 
+        case ARENA_ALLOC: /* mm_arena_alloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+
+	    if ((arena = get_arena(trace, trace->ops[i].arena)) == NULL ||
+		(p = mm_arena_alloc(arena, size)) == NULL)
+		app_error("mm_arena_alloc failed in eval_mm_util");
+
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+
+	    total_size += size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case ARENA_RESET: /* mm_arena_reset */
+	    index = trace->ops[i].index;
+	    for (j = index; j < index + trace->ops[i].size; j++)
+		total_size -= trace->block_sizes[trace->reset_ids[j]];
+	    if (trace->arenas[trace->ops[i].arena] != NULL)
+		mm_arena_reset(trace->arenas[trace->ops[i].arena]);
+	    break;
+
+        case HANDLE_ALLOC: /* mm_halloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+
+	    if ((trace->handles[index] = mm_halloc(size)) == 0)
+		app_error("mm_halloc failed in eval_mm_util");
+	    trace->block_sizes[index] = size;
+
+	    total_size += size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case HANDLE_FREE: /* mm_hfree */
+	    index = trace->ops[i].index;
+	    mm_hfree(trace->handles[index]);
+	    trace->handles[index] = 0;
+	    total_size -= trace->block_sizes[index];
+	    break;
+
+        case COMPACT: /* mm_compact */
+	    mm_compact();
+	    max_total_size = total_size;
+	    max_heap_size = 0;
+	    break;
+
 	default:
 	    app_error("Nonexistent request type in eval_mm_util");
 
         }
+
+	if (mem_heapsize() > max_heap_size) {
+	    max_heap_size = mem_heapsize();
+	    if (mm_stats != NULL)
+		mm_stats(&stats->alloc_peak);
+	}
+	locality_step(&loc, trace, i);
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    if (mm_stats != NULL)
+	mm_stats(&stats->alloc);
+    destroy_arenas(trace);
+    locality_finish(&loc, stats);
+    return ((double)max_total_size / (double)max_heap_size);
 }
 
 
@@ -784,23 +1951,54 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
  */
 static void eval_mm_speed(void *ptr)
 {
-    int i, index, size, newsize;
+    int i, j, index, size, newsize;
     char *p, *newp, *oldp, *block;
+    mm_arena_t *arena;
     trace_t *trace = ((speed_t *)ptr)->trace;
+    int batch = ((speed_t *)ptr)->batch;
 
     /* Reset the heap and initialize the mm package */
     mem_reset_brk();
     if (mm_init() < 0) 
 	app_error("mm_init failed in eval_mm_speed");
+    memset(trace->arenas, 0, trace->num_arenas * sizeof(mm_arena_t *));
+    memset(trace->handles, 0, trace->num_ids * sizeof(mm_handle_t));
 
     /* Interpret each trace request */
-    for (i = 0;  i < trace->num_ops;  i++)
+    for (i = 0;  i < trace->num_ops;  i++) {
+	if (batch && trace->ops[i].run > 1) {
+	    if (trace->ops[i].type == ALLOC) {
+		if (mm_malloc_batch(trace->ops[i].run, trace->ops[i].size, 
+				    trace->batch) < trace->ops[i].run)
+		    app_error("mm_malloc_batch error in eval_mm_speed");
+		for (j = 0; j < trace->ops[i].run; j++)
+		    trace->blocks[trace->ops[i+j].index] = trace->batch[j];
+		if (trace->touches != NULL)
+		    touch_payloads(trace, i, i + trace->ops[i].run);
+	    }
+	    else {
+		/* 
+		 * The run's touches only read blocks that outlive some of
+		 * its frees, so make them before the batch frees anything
+		 */
+		if (trace->touches != NULL)
+		    touch_payloads(trace, i, i + trace->ops[i].run);
+		for (j = 0; j < trace->ops[i].run; j++)
+		    trace->batch[j] = trace->blocks[trace->ops[i+j].index];
+		mm_free_batch(trace->ops[i].run, trace->batch);
+	    }
+	    i += trace->ops[i].run - 1;
+	    continue;
+	}
+
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = (trace->ops[i].hint != MM_HINT_NONE) ? 
+		 mm_malloc_hint(size, trace->ops[i].hint) : 
+		 mm_malloc(size)) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
             break;
@@ -817,12 +2015,99 @@ static void eval_mm_speed(void *ptr)
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+	    /* block_sizes still holds the sizes from eval_mm_valid */
+	    if (mm_free_sized != NULL)
+		mm_free_sized(block, trace->block_sizes[index]);
+	    else
+		mm_free(block);
+            break;
+
+        case ARENA_ALLOC: /* mm_arena_alloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((arena = get_arena(trace, trace->ops[i].arena)) == NULL ||
+                (p = mm_arena_alloc(arena, size)) == NULL)
+		app_error("mm_arena_alloc error in eval_mm_speed");
+            trace->blocks[index] = p;
+            break;
+
+        case ARENA_RESET: /* mm_arena_reset */
+            if ((arena = trace->arenas[trace->ops[i].arena]) != NULL)
+                mm_arena_reset(arena);
+            break;
+
+        case HANDLE_ALLOC: /* mm_halloc */
+            index = trace->ops[i].index;
+            if ((trace->handles[index] = mm_halloc(trace->ops[i].size)) == 0)
+		app_error("mm_halloc error in eval_mm_speed");
+            break;
+
+        case HANDLE_FREE: /* mm_hfree */
+            index = trace->ops[i].index;
+            mm_hfree(trace->handles[index]);
+            break;
+
+        case COMPACT: /* mm_compact */
+            mm_compact();
             break;
 
 	default:
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
+
+	/* Write the new payload and read some live ones (-P) */
+	if (trace->touches != NULL)
+	    touch_payloads(trace, i, i + 1);
+    }
+
+    destroy_arenas(trace);
+}
+
+/*
+ * find_kernel - Returns the kernel compiled from the named trace file,
+ *    or NULL if kernels.c has none. The kernel is matched by the file
+ *    name without its directory, and is ignored if its number of
+ *    requests shows that it was compiled from another version.
+ */
+static kernel_t *find_kernel(char *tracefile, int num_ops)
+{
+    kernel_t *kernel;
+    char *name;
+
+    if ((name = strrchr(tracefile, '/')) != NULL)
+	name++;
+    else
+	name = tracefile;
+
+    for (kernel = kernels; kernel->name != NULL; kernel++) {
+	if (!strcmp(kernel->name, name)) {
+	    if (kernel->num_ops != num_ops) {
+		printf("Warning: kernel for %s is stale; rebuild kernels.c\n", 
+		       name);
+		return NULL;
+	    }
+	    return kernel;
+	}
+    }
+    return NULL;
+}
+
+/*
+ * eval_kernel_speed - This is the function that is used by fcyc()
+ *    to measure the running time of a compiled trace kernel. The
+ *    kernel replays the trace without the interpreter, so only the
+ *    mm package is timed.
+ */
+static void eval_kernel_speed(void *ptr)
+{
+    kernel_t *kernel = (kernel_t *)ptr;
+
+    /* Reset the heap and initialize the mm package */
+    mem_reset_brk();
+    if (mm_init() < 0) 
+	app_error("mm_init failed in eval_kernel_speed");
+
+    kernel->run();
 }
 
 /*
@@ -833,13 +2118,15 @@ static void eval_mm_speed(void *ptr)
  */
 static int eval_libc_valid(trace_t *trace, int tracenum)
 {
-    int i, newsize;
+    int i, j, newsize;
     char *p, *newp, *oldp;
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
 
         case ALLOC: /* malloc */
+        case ARENA_ALLOC: /* libc has no arenas, so use malloc... */
+        case HANDLE_ALLOC: /* ... nor handles */
 	    if ((p = malloc(trace->ops[i].size)) == NULL) {
 		malloc_error(tracenum, i, "libc malloc failed");
 		unix_error("System message");
@@ -858,9 +2145,19 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 	    break;
 	    
         case FREE: /* free */
+        case HANDLE_FREE:
 	    free(trace->blocks[trace->ops[i].index]);
 	    break;
 
+        case COMPACT: /* libc does not compact */
+	    break;
+
+        case ARENA_RESET: /* ... and free each block of the arena */
+	    for (j = trace->ops[i].index; 
+		 j < trace->ops[i].index + trace->ops[i].size; j++)
+		free(trace->blocks[trace->reset_ids[j]]);
+	    break;
+
 	default:
 	    app_error("invalid operation type  in eval_libc_valid");
 	}
@@ -869,6 +2166,126 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
     return 1;
 }
 
+/*
+ * eval_libc_util - Evaluate the space utilization of libc malloc on
+ *    a trace. As for the mm package, utilization is the peak aggregate
+ *    payload over the peak heap size. libc cannot be reset between
+ *    traces, so the heap of a trace is charged (from mallinfo2) as the
+ *    arena growth, plus the arena memory that was free at the start and
+ *    that the trace's chunks may have taken, plus the mmapped chunks.
+ *    Also records the malloc_usable_size overhead at the peak and the
+ *    growth of the RSS.
+ */
+static double eval_libc_util(trace_t *trace, stats_t *stats)
+{
+    int i, j, index;
+    size_t total_size = 0, max_total_size = 0;
+    size_t usable_size = 0, peak_usable_size = 0;
+    size_t heap_size, max_heap_size = 0;
+    size_t system, inuse, mapped, base_system, base_inuse, base_mapped;
+    long rss, max_rss, base_rss;
+    char *p, *newp, *oldp;
+    locality_t loc;
+
+    /* Give back what the previous traces left behind */
+    malloc_trim(0);
+    locality_init(&loc, trace);
+    libc_heap_info(&base_system, &base_inuse, &base_mapped);
+    base_rss = max_rss = rss_kbytes();
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* malloc */
+        case ARENA_ALLOC: /* libc has no arenas, so use malloc... */
+        case HANDLE_ALLOC: /* ... nor handles */
+	    if ((p = malloc(trace->ops[i].size)) == NULL)
+		unix_error("malloc failed in eval_libc_util");
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = trace->ops[i].size;
+	    total_size += trace->ops[i].size;
+	    usable_size += malloc_usable_size(p);
+	    break;
+
+	case REALLOC: /* realloc */
+	    oldp = trace->blocks[index];
+	    usable_size -= malloc_usable_size(oldp);
+	    if ((newp = realloc(oldp, trace->ops[i].size)) == NULL)
+		unix_error("realloc failed in eval_libc_util");
+	    trace->blocks[index] = newp;
+	    total_size += trace->ops[i].size - trace->block_sizes[index];
+	    trace->block_sizes[index] = trace->ops[i].size;
+	    usable_size += malloc_usable_size(newp);
+	    break;
+	    
+        case FREE: /* free */
+        case HANDLE_FREE:
+	    p = trace->blocks[index];
+	    total_size -= trace->block_sizes[index];
+	    usable_size -= malloc_usable_size(p);
+	    free(p);
+	    break;
+
+        case COMPACT: /* libc does not compact */
+	    break;
+
+        case ARENA_RESET: /* ... and free each block of the arena */
+	    for (j = index; j < index + trace->ops[i].size; j++) {
+		p = trace->blocks[trace->reset_ids[j]];
+		total_size -= trace->block_sizes[trace->reset_ids[j]];
+		usable_size -= malloc_usable_size(p);
+		free(p);
+	    }
+	    break;
+
+	default:
+	    app_error("invalid operation type  in eval_libc_util");
+	}
+
+	if (total_size > max_total_size) {
+	    max_total_size = total_size;
+	    peak_usable_size = usable_size;
+	}
+
+	/* 
+	 * Only a request that allocates can grow the heap, so only then
+	 * measure it (mallinfo2 walks the arena's bins, which is too slow
+	 * to do after every request). The RSS can only grow much when the
+	 * heap does, so sample it when the heap reaches a new peak.
+	 */
+	if (trace->ops[i].type == ALLOC || trace->ops[i].type == REALLOC ||
+	    trace->ops[i].type == ARENA_ALLOC || 
+	    trace->ops[i].type == HANDLE_ALLOC) {
+	    libc_heap_info(&system, &inuse, &mapped);
+	    heap_size = 0;
+	    if (system > base_system)
+		heap_size += system - base_system;
+	    if (mapped > base_mapped)
+		heap_size += mapped - base_mapped;
+	    if (inuse > base_inuse)
+		heap_size += (inuse - base_inuse < base_system - base_inuse) ?
+		    inuse - base_inuse : base_system - base_inuse;
+	    if (heap_size > max_heap_size) {
+		max_heap_size = heap_size;
+		if ((rss = rss_kbytes()) > max_rss)
+		    max_rss = rss;
+	    }
+	}
+	locality_step(&loc, trace, i);
+    }
+
+    locality_finish(&loc, stats);
+    stats->usable = max_total_size ? 
+	(double)peak_usable_size / max_total_size : 0;
+    stats->rss = max_rss - base_rss;
+
+    /* The peak may fit entirely in memory the trace did not have to add */
+    if (max_heap_size < max_total_size)
+	return 1.0;
+    return (double)max_total_size / max_heap_size;
+}
+
 /* 
  * eval_libc_speed - This is the function that is used by fcyc() to
  *    measure the running time of the libc malloc package on the set
@@ -876,7 +2293,7 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
  */
 static void eval_libc_speed(void *ptr)
 {
-    int i;
+    int i, j;
     int index, size, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
@@ -884,6 +2301,8 @@ static void eval_libc_speed(void *ptr)
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
         case ALLOC: /* malloc */
+        case ARENA_ALLOC: /* libc has no arenas, so use malloc... */
+        case HANDLE_ALLOC: /* ... nor handles */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 	    if ((p = malloc(size)) == NULL)
@@ -902,11 +2321,25 @@ static void eval_libc_speed(void *ptr)
 	    break;
 	    
         case FREE: /* free */
+        case HANDLE_FREE:
 	    index = trace->ops[i].index;
 	    block = trace->blocks[index];
 	    free(block);
 	    break;
+
+        case COMPACT: /* libc does not compact */
+	    break;
+
+        case ARENA_RESET: /* ... and free each block of the arena */
+	    for (j = trace->ops[i].index; 
+		 j < trace->ops[i].index + trace->ops[i].size; j++)
+		free(trace->blocks[trace->reset_ids[j]]);
+	    break;
 	}
+
+	/* Write the new payload and read some live ones (-P) */
+	if (trace->touches != NULL)
+	    touch_payloads(trace, i, i + 1);
     }
 }
 
@@ -916,7 +2349,11 @@ static void eval_libc_speed(void *ptr)
 
 
 /*
- * printresults - prints a performance summary for some malloc package
+ * printresults - prints a performance summary for some malloc package.
+ *     Next to util are the locality stats of the util replay: the median
+ *     distance in bytes between successive allocations, the share of
+ *     them on the same cache line and on the same page, and the page
+ *     spread of the live set (1.00 is perfectly packed).
  */
 static void printresults(int n, stats_t *stats) 
 {
@@ -924,54 +2361,538 @@ static void printresults(int n, stats_t *stats)
     double secs = 0;
     double ops = 0;
     double util = 0;
+    double dist = 0, same_line = 0, same_page = 0, spread = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
-	   "trace", " valid", "util", "ops", "secs", "Kops");
+    printf("%5s%7s %5s%8s%6s%6s%7s%8s%10s%8s\n", 
+	   "trace", " valid", "util", "dist", "line", "page", "spread",
+	   "ops", "secs", "Kops");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%5.0f%%%5.0f%%%7.2f%8.0f%10.6f%8.0f\n", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
+		   stats[i].dist,
+		   stats[i].same_line*100.0,
+		   stats[i].same_page*100.0,
+		   stats[i].spread,
 		   stats[i].ops,
 		   stats[i].secs,
 		   (stats[i].ops/1e3)/stats[i].secs);
 	    secs += stats[i].secs;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
+	    dist += stats[i].dist;
+	    same_line += stats[i].same_line;
+	    same_page += stats[i].same_page;
+	    spread += stats[i].spread;
 	}
 	else {
-	    printf("%2d%10s%6s%8s%10s%6s\n", 
+	    printf("%2d%10s%6s%8s%6s%6s%7s%8s%10s%8s\n", 
 		   i,
 		   "no",
 		   "-",
 		   "-",
 		   "-",
+		   "-",
+		   "-",
+		   "-",
+		   "-",
 		   "-");
 	}
     }
 
     /* Print the aggregate results for the set of traces */
     if (errors == 0) {
-	printf("%12s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	printf("%12s%5.0f%%%8.0f%5.0f%%%5.0f%%%7.2f%8.0f%10.6f%8.0f\n", 
 	       "Total       ",
 	       (util/n)*100.0,
+	       dist/n,
+	       (same_line/n)*100.0,
+	       (same_page/n)*100.0,
+	       spread/n,
 	       ops, 
 	       secs,
 	       (ops/1e3)/secs);
     }
     else {
-	printf("%12s%6s%8s%10s%6s\n", 
+	printf("%12s%6s%8s%6s%6s%7s%8s%10s%8s\n", 
 	       "Total       ",
 	       "-", 
 	       "-", 
 	       "-", 
+	       "-", 
+	       "-", 
+	       "-", 
+	       "-", 
 	       "-");
     }
 
 }
 
+/*
+ * printlibcstats - prints the space overheads measured during the
+ *     libc utilization run of each trace
+ */
+static void printlibcstats(int n, stats_t *stats)
+{
+    int i;
+
+    printf("%5s%10s%11s\n", "trace", "usable", "RSS (KB)");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid) 
+	    printf("%2d%12.2fx%11.0f\n",
+		   i,
+		   stats[i].usable,
+		   stats[i].rss);
+	else
+	    printf("%2d%13s%11s\n", i, "-", "-");
+    }
+}
+
+/*
+ * printfitstats - prints the find_fit search lengths measured during
+ *     the utilization run of each trace
+ */
+static void printfitstats(int n, stats_t *stats)
+{
+    int i;
+    double searches = 0;
+    double steps = 0;
+
+    printf("Fit policy: %s\n", stats[0].fit.policy ? stats[0].fit.policy : "-");
+    printf("%5s%10s%9s%8s\n", "trace", "searches", "avg len", "misses");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid && stats[i].fit.searches > 0) {
+	    printf("%2d%13lu%9.2f%8lu\n",
+		   i,
+		   stats[i].fit.searches,
+		   (double)stats[i].fit.steps / stats[i].fit.searches,
+		   stats[i].fit.misses);
+	    searches += stats[i].fit.searches;
+	    steps += stats[i].fit.steps;
+	}
+	else {
+	    printf("%2d%13s%9s%8s\n", i, "-", "-", "-");
+	}
+    }
+    if (searches > 0)
+	printf("%12s%15.2f\n", "Total       ", steps / searches);
+}
+
+/*
+ * have_alloc_stats - does the allocator keep mm_stats? (main cannot
+ *     test mm_stats itself, since its stats array has the same name)
+ */
+static int have_alloc_stats(void)
+{
+    return mm_stats != NULL;
+}
+
+/*
+ * search_len_pct - the longest search length in the search_len bucket
+ *     that holds percentile pct of the searches
+ */
+static unsigned long search_len_pct(mm_stats_t *alloc, double pct)
+{
+    int b;
+    double searches = 0;
+    double seen = 0;
+
+    for (b = 0; b < MM_STATS_BUCKETS; b++)
+	searches += alloc->search_len[b];
+    for (b = 0; b < MM_STATS_BUCKETS - 1; b++) {
+	seen += alloc->search_len[b];
+	if (seen >= pct * searches)
+	    break;
+    }
+    return (1UL << b) - 1;
+}
+
+/*
+ * printallocstats - prints the allocator's own statistics (mm_stats)
+ *     for the utilization run of each trace. The heap, live and free
+ *     block figures are from when the heap last grew; the counters
+ *     are over the whole run. With -V, also prints the free blocks by
+ *     size class and the search lengths.
+ */
+static void printallocstats(int n, stats_t *stats)
+{
+    int i, k, last;
+    char coalesce[MAXLINE];
+    unsigned long free_blocks;
+    mm_stats_t *peak, *alloc;
+
+    printf("Allocator stats (mm_stats) of the utilization runs\n");
+    printf("%5s%9s%9s%7s%7s%8s  %-23s%10s%8s%8s\n", "trace", "heap KB", 
+	   "live KB", "free", "sbrk", "splits", "coalesce 1/2/3/4", 
+	   "copy KB", "len p50", "len p99");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%12s%9s%7s%7s%8s  %-23s%10s%8s%8s\n", i, "-", "-", 
+		   "-", "-", "-", "-", "-", "-", "-");
+	    continue;
+	}
+	peak = &stats[i].alloc_peak;
+	alloc = &stats[i].alloc;
+	for (k = 0, free_blocks = 0; k < MM_STATS_CLASSES; k++)
+	    free_blocks += peak->free_blocks[k];
+	sprintf(coalesce, "%lu/%lu/%lu/%lu", alloc->coalesce[0], 
+		alloc->coalesce[1], alloc->coalesce[2], alloc->coalesce[3]);
+	printf("%2d%12.1f%9.1f%7lu%7lu%8lu  %-23s%10.1f%8lu%8lu\n",
+	       i,
+	       peak->heap_bytes / 1024.0,
+	       peak->live_bytes / 1024.0,
+	       free_blocks,
+	       alloc->sbrk_calls,
+	       alloc->splits,
+	       coalesce,
+	       alloc->realloc_copied / 1024.0,
+	       search_len_pct(alloc, 0.5),
+	       search_len_pct(alloc, 0.99));
+    }
+    if (verbose < 2)
+	return;
+
+    /* The histograms, up to their last nonzero entry */
+    printf("\nFree blocks by size class (16B, 32B, 64B, ...) and find_fit "
+	   "searches\nby length (0, 1, 2-3, 4-7, ...)\n");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	peak = &stats[i].alloc_peak;
+	alloc = &stats[i].alloc;
+	printf("%2d  free  ", i);
+	for (last = MM_STATS_CLASSES - 1; 
+	     last > 0 && peak->free_blocks[last] == 0; last--)
+	    ;
+	for (k = 0; k <= last; k++)
+	    printf(" %lu", peak->free_blocks[k]);
+	printf("\n    search");
+	for (last = MM_STATS_BUCKETS - 1; 
+	     last > 0 && alloc->search_len[last] == 0; last--)
+	    ;
+	for (k = 0; k <= last; k++)
+	    printf(" %lu", alloc->search_len[k]);
+	printf("\n");
+    }
+}
+
+/*
+ * printremapstats - prints the realloc copies that the allocator
+ *     avoided by growing regions with mremap, in the utilization run
+ *     of each trace
+ */
+static void printremapstats(int n, stats_t *stats)
+{
+    int i;
+    double remaps = 0;
+    double bytes = 0;
+
+    printf("Realloc copies avoided by mremap\n");
+    printf("%5s%9s%12s\n", "trace", "remaps", "KB kept");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid) {
+	    printf("%2d%12.0f%12.1f\n", i, stats[i].remaps, 
+		   stats[i].remap_bytes / 1024);
+	    remaps += stats[i].remaps;
+	    bytes += stats[i].remap_bytes;
+	}
+	else {
+	    printf("%2d%12s%12s\n", i, "-", "-");
+	}
+    }
+    printf("%5s%9.0f%12.1f\n", "Total", remaps, bytes / 1024);
+}
+
+/*
+ * have_remaps - did the allocator grow any region with mremap?
+ */
+static int have_remaps(int n, stats_t *stats)
+{
+    int i;
+
+    for (i=0; i < n; i++)
+	if (stats[i].valid && stats[i].remaps > 0)
+	    return 1;
+    return 0;
+}
+
+/*
+ * printbatchresults - compares the running time of each trace with its
+ *     running time when runs of allocs and frees are batched
+ */
+static void printbatchresults(int n, stats_t *stats)
+{
+    int i;
+    double secs = 0;
+    double batch_secs = 0;
+
+    printf("Batched replay:\n");
+    printf("%5s%9s%10s%12s%9s\n", "trace", "batches", "secs", "batch secs", "speedup");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid && stats[i].batch_secs > 0) {
+	    printf("%2d%12.0f%10.6f%12.6f%8.2fx\n",
+		   i,
+		   stats[i].batches,
+		   stats[i].secs,
+		   stats[i].batch_secs,
+		   stats[i].secs / stats[i].batch_secs);
+	    secs += stats[i].secs;
+	    batch_secs += stats[i].batch_secs;
+	}
+	else {
+	    printf("%2d%12s%10s%12s%9s\n", i, "-", "-", "-", "-");
+	}
+    }
+    if (batch_secs > 0)
+	printf("%12s%17.6f%12.6f%8.2fx\n", "Total       ", secs, batch_secs, 
+	       secs / batch_secs);
+}
+
+/*
+ * printkernelresults - compares the running time of each trace under
+ *     the interpreter with the running time of its compiled kernel. The
+ *     difference is the interpreter's overhead, as a share of the
+ *     interpreted time.
+ */
+static void printkernelresults(int n, stats_t *stats)
+{
+    int i;
+    double ops = 0;
+    double secs = 0;
+    double kernel_secs = 0;
+
+    printf("Compiled kernels:\n");
+    printf("%5s%8s%10s%8s%12s%8s%10s\n", 
+	   "trace", "ops", "secs", "Kops", "kernel secs", "Kops", "driver");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid && stats[i].kernel_secs > 0) {
+	    printf("%2d%11.0f%10.6f%8.0f%12.6f%8.0f%9.0f%%\n",
+		   i,
+		   stats[i].ops,
+		   stats[i].secs,
+		   (stats[i].ops/1e3)/stats[i].secs,
+		   stats[i].kernel_secs,
+		   (stats[i].ops/1e3)/stats[i].kernel_secs,
+		   100*(1 - stats[i].kernel_secs/stats[i].secs));
+	    ops += stats[i].ops;
+	    secs += stats[i].secs;
+	    kernel_secs += stats[i].kernel_secs;
+	}
+	else {
+	    printf("%2d%11s%10s%8s%12s%8s%10s\n", i, "-", "-", "-", "-", "-", "-");
+	}
+    }
+    if (kernel_secs > 0)
+	printf("%12s%11.6f%8.0f%12.6f%8.0f%9.0f%%\n", "Total", 
+	       secs, (ops/1e3)/secs, kernel_secs, (ops/1e3)/kernel_secs,
+	       100*(1 - kernel_secs/secs));
+}
+
+/*
+ * json_string - writes s to fp as a JSON string
+ */
+static void json_string(FILE *fp, char *s)
+{
+    fputc('"', fp);
+    for (; *s != '\0'; s++) {
+	if (*s == '"' || *s == '\\')
+	    fprintf(fp, "\\%c", *s);
+	else if ((unsigned char)*s < ' ')
+	    fprintf(fp, "\\u%04x", *s);
+	else
+	    fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+/*
+ * write_json - writes the mm results of this run to a file as JSON:
+ *     the allocator (team name), the source revision (git describe, if
+ *     the driver runs in a git tree), the command line and the time of
+ *     the run, the perf index, and for each trace its util, ops and
+ *     K-best secs plus JSON_SAMPLES single run times. mdcompare.pl tests
+ *     two of these files for regressions.
+ */
+static void write_json(char *file, char *command, char **tracefiles, int n,
+		       stats_t *stats, double perfindex, double max_throughput)
+{
+    FILE *fp, *git;
+    char revision[MAXLINE], date[MAXLINE];
+    time_t now;
+    int i, j;
+
+    strcpy(revision, "unknown");
+    if ((git = popen("git describe --always --dirty 2>/dev/null", "r")) != NULL) {
+	if (fgets(revision, MAXLINE, git) == NULL || revision[0] == '\0')
+	    strcpy(revision, "unknown");
+	revision[strcspn(revision, "\n")] = '\0';
+	pclose(git);
+    }
+    now = time(NULL);
+    strftime(date, MAXLINE, "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    if ((fp = fopen(file, "w")) == NULL) {
+	sprintf(msg, "Could not open %s in write_json", file);
+	unix_error(msg);
+    }
+    fprintf(fp, "{\n  \"allocator\": ");
+    json_string(fp, team.teamname);
+    fprintf(fp, ",\n  \"revision\": ");
+    json_string(fp, revision);
+    fprintf(fp, ",\n  \"command\": ");
+    json_string(fp, command);
+    fprintf(fp, ",\n  \"date\": \"%s\",\n", date);
+    fprintf(fp, "  \"errors\": %d,\n", errors);
+    fprintf(fp, "  \"perfindex\": %.1f,\n", perfindex);
+    fprintf(fp, "  \"throughput_cap_kops\": %.0f,\n", max_throughput/1e3);
+    fprintf(fp, "  \"traces\": [");
+    for (i = 0; i < n; i++) {
+	fprintf(fp, "%s\n    {\"name\": ", i ? "," : "");
+	json_string(fp, tracefiles[i]);
+	fprintf(fp, ", \"valid\": %s", stats[i].valid ? "true" : "false");
+	if (stats[i].valid) {
+	    fprintf(fp, ", \"util\": %.6f, \"ops\": %.0f, \"secs\": %.9f",
+		    stats[i].util, stats[i].ops, stats[i].secs);
+	    if (stats[i].samples != NULL) {
+		fprintf(fp, ",\n     \"samples\": [");
+		for (j = 0; j < JSON_SAMPLES; j++)
+		    fprintf(fp, "%s%.9f", j ? ", " : "", stats[i].samples[j]);
+		fprintf(fp, "]");
+	    }
+	}
+	fprintf(fp, "}");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+}
+
+/*
+ * printtlbstats - prints how much of the heap was backed by huge pages
+ *     at the end of each trace, and the dTLB misses of one run of it
+ */
+static void printtlbstats(int n, stats_t *stats)
+{
+    int i;
+    double huge;
+
+    printf("Heap pages: %s\n", mem_page_mode());
+    printf("%5s%10s%10s%7s%11s%10s\n", 
+	   "trace", "heap KB", "huge KB", "huge", "dTLB miss", "miss/Kop");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%13s%10s%7s%11s%10s\n", i, "-", "-", "-", "-", "-");
+	    continue;
+	}
+	/* 
+	 * A huge page can extend past the end of the heap, so report
+	 * only the part inside it, and like the RSS growth of
+	 * eval_libc_util, never less than nothing
+	 */
+	huge = stats[i].huge_bytes;
+	if (huge > stats[i].heap_bytes)
+	    huge = stats[i].heap_bytes;
+	if (huge < 0)
+	    huge = 0;
+	printf("%2d%13.0f%10.0f%6.0f%%", 
+	       i,
+	       stats[i].heap_bytes / 1024,
+	       huge / 1024,
+	       stats[i].heap_bytes > 0 ? (huge / stats[i].heap_bytes) * 100.0 : 0);
+	if (stats[i].tlb_misses >= 0)
+	    printf("%11.0f%10.2f\n", 
+		   stats[i].tlb_misses,
+		   stats[i].tlb_misses / (stats[i].ops / 1e3));
+	else
+	    printf("%11s%10s\n", "-", "-");
+    }
+}
+
+/*
+ * tlb_counter_open - Open a disabled hardware counter of the dTLB load
+ *     misses of this process in user mode. Returns -1 if the system has
+ *     no such counter or does not let us use it (see perf_event_paranoid)
+ */
+static int tlb_counter_open(void)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | 
+	(PERF_COUNT_HW_CACHE_OP_READ << 8) | 
+	(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+/*
+ * tlb_misses - Run the trace once more with the dTLB miss counter fd
+ *     enabled, and return the count, or -1 if there is no counter
+ */
+static double tlb_misses(int fd, speed_t *speed_params)
+{
+#ifdef __linux__
+    long long count;
+
+    if (fd < 0)
+	return -1;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    eval_mm_speed(speed_params);
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+	return -1;
+    return (double)count;
+#else
+    return -1;
+#endif
+}
+
+/*
+ * libc_heap_info - Report the bytes that libc malloc has obtained from
+ *     the system for its arenas, the bytes of arena chunks in use, and
+ *     the bytes in mmapped chunks
+ */
+static void libc_heap_info(size_t *system, size_t *inuse, size_t *mapped)
+{
+#if HAVE_MALLINFO2
+    struct mallinfo2 mi = mallinfo2();
+#else
+    struct mallinfo mi = mallinfo();
+#endif
+
+    *system = (size_t)mi.arena;
+    *inuse = (size_t)mi.uordblks;
+    *mapped = (size_t)mi.hblkhd;
+}
+
+/*
+ * rss_kbytes - Return the resident set size of the process in KB, or 0
+ *     if /proc is not available
+ */
+static long rss_kbytes(void)
+{
+    FILE *fp;
+    long size, resident = 0;
+
+    if ((fp = fopen("/proc/self/statm", "r")) == NULL)
+	return 0;
+    if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+	resident = 0;
+    fclose(fp);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -1004,14 +2925,30 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValbkH] [-f <file>] [-t <dir>] [-p <policy>]\n");
+    fprintf(stderr, "               [-T <name>=<value>]... [-w <weight>] [-m <threads>]\n");
+    fprintf(stderr, "               [-P <model>[:<fraction>]] [-j <file>] [-s <bytes>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-b         Also time runs of allocs/frees replayed as batches.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
-    fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-H         Ignore the lifetime hints in the traces.\n");
+    fprintf(stderr, "\t-j <file>  Write the mm results as JSON to <file> (see mdcompare.pl).\n");
+    fprintf(stderr, "\t-k         Also time the traces compiled into kernels.c.\n");
+    fprintf(stderr, "\t-l         Run libc malloc as well, and print its util and overheads.\n");
+    fprintf(stderr, "\t-m <n>     Run the multi-threaded benchmarks at 1..n threads.\n");
+    fprintf(stderr, "\t-p <pol>   Fit policy (first, next, best, good[:k], exact).\n");
+    fprintf(stderr, "\t-P <m>[:f] Touch payloads in the timed runs, reading a share f\n");
+    fprintf(stderr, "\t           (default %.2f) of the live blocks by model recent or uniform.\n",
+	    TOUCH_FRACTION);
+    fprintf(stderr, "\t-s <n>     Let the break cover at most n bytes; past that, the heap\n");
+    fprintf(stderr, "\t           grows in separate segments.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T <n>=<v> Set a tuning parameter of the mm package.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
+    fprintf(stderr, "\t-w <wt>    Weight of util in the perf index (default %.2f).\n",
+	    UTIL_WEIGHT);
 }
@@ -2,7 +2,18 @@
  * memlib.c - a module that simulates the memory system.  Needed because it 
  *            allows us to interleave calls from the student's malloc package 
  *            with the system's malloc package in libc.
+ *
+ * The heap grows up from the bottom of a MAX_HEAP reservation with
+ * mem_sbrk. Once the break cannot grow any more, mem_segment hands out
+ * separate segments, taken from the top of the reservation down, the
+ * way mmap places mappings: the break stops below the lowest segment,
+ * or earlier if mem_set_brk_limit says so.
+ *
+ * Large blocks may instead live in regions of their own, which are
+ * real mappings outside the reservation. A region grows or shrinks
+ * with mremap, which moves its pages rather than copying them.
  */
+#define _GNU_SOURCE  /* for mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -14,10 +25,32 @@
 #include "memlib.h"
 #include "config.h"
 
+/* How the storage for the simulated heap was obtained */
+#define MEM_MALLOC  0  /* plain malloc (no mmap) */
+#define MEM_MMAP    1  /* anonymous mmap with normal pages */
+#define MEM_THP     2  /* ... with MADV_HUGEPAGE (transparent huge pages) */
+#define MEM_HUGETLB 3  /* MAP_HUGETLB from the reserved huge page pool */
+
 /* private variables */
 static char *mem_start_brk;  /* points to first byte of heap */
 static char *mem_brk;        /* points to last byte of heap */
 static char *mem_max_addr;   /* largest legal heap address */ 
+static char *mem_map_start;  /* start of the mapping that holds the heap */
+static size_t mem_map_size;  /* ... and its size */
+static int mem_mode;         /* one of the MEM_xxx values above */
+static size_t mem_brk_limit = MAX_HEAP; /* most bytes the break may cover */
+static char *mem_seg_lo[MAX_SEGMENTS];   /* the segments, from the top down */
+static size_t mem_seg_size[MAX_SEGMENTS];
+static int mem_num_segs;     /* number of segments handed out */
+static char *mem_reg_lo[MAX_REGIONS];    /* the regions, in no order */
+static size_t mem_reg_size[MAX_REGIONS];
+static int mem_num_regs;     /* number of regions mapped */
+static unsigned long mem_remaps; /* regions grown by mem_remap_region... */
+static size_t mem_remapped;  /* ... and the bytes they kept in place */
+
+static char *mem_map_heap(size_t size);
+static int mem_region_index(char *lo);
+static size_t mem_round_page(size_t size);
 
 /* 
  * mem_init - initialize the memory system model
@@ -25,13 +58,65 @@ static char *mem_max_addr;   /* largest legal heap address */
 void mem_init(void)
 {
     /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
-	fprintf(stderr, "mem_init_vm: malloc error\n");
-	exit(1);
+    if ((mem_start_brk = mem_map_heap(MAX_HEAP)) == NULL) {
+	if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
+	    fprintf(stderr, "mem_init_vm: malloc error\n");
+	    exit(1);
+	}
+	mem_mode = MEM_MALLOC;
     }
 
     mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
     mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_num_segs = 0;                         /* ... and has no segments */
+}
+
+/*
+ * mem_map_heap - map size bytes for the heap, aligned to HUGE_PAGE_SIZE
+ *    so that the heap can start on a huge page. Tries huge pages from
+ *    the reserved pool first, then normal pages with MADV_HUGEPAGE, then
+ *    plain normal pages. Returns NULL if mmap is not usable at all.
+ */
+static char *mem_map_heap(size_t size)
+{
+    char *p, *aligned;
+    size_t extra;
+
+    size = (size + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1);
+
+#if USE_HUGE_PAGES && defined(MAP_HUGETLB)
+    /* Huge page mappings are always aligned to the huge page size */
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, 
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+	mem_map_start = p;
+	mem_map_size = size;
+	mem_mode = MEM_HUGETLB;
+	return p;
+    }
+#endif
+
+    /* Over-allocate by one huge page, then trim to an aligned range */
+    p = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, 
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+	return NULL;
+    aligned = (char *)(((unsigned long)p + HUGE_PAGE_SIZE - 1) & 
+		       ~((unsigned long)HUGE_PAGE_SIZE - 1));
+    extra = aligned - p;
+    if (extra > 0)
+	munmap(p, extra);
+    if (HUGE_PAGE_SIZE - extra > 0)
+	munmap(aligned + size, HUGE_PAGE_SIZE - extra);
+
+    mem_map_start = aligned;
+    mem_map_size = size;
+    mem_mode = MEM_MMAP;
+#if USE_HUGE_PAGES && defined(MADV_HUGEPAGE)
+    if (madvise(aligned, size, MADV_HUGEPAGE) == 0)
+	mem_mode = MEM_THP;
+#endif
+    return aligned;
 }
 
 /* 
@@ -39,35 +124,253 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    mem_reset_brk();
+    if (mem_mode == MEM_MALLOC)
+	free(mem_start_brk);
+    else
+	munmap(mem_map_start, mem_map_size);
 }
 
 /*
- * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ * mem_reset_brk - reset the simulated brk pointer to make an empty heap,
+ *    and give back all segments and regions
  */
 void mem_reset_brk()
 {
     mem_brk = mem_start_brk;
+    mem_num_segs = 0;
+    while (mem_num_regs > 0) {
+	mem_num_regs--;
+	munmap(mem_reg_lo[mem_num_regs], mem_reg_size[mem_num_regs]);
+    }
+    mem_remaps = 0;
+    mem_remapped = 0;
+}
+
+/*
+ * mem_set_brk_limit - limit the break to the first bytes of the
+ *    reservation, as if a mapping sat right above them
+ */
+void mem_set_brk_limit(size_t bytes)
+{
+    mem_brk_limit = (bytes < MAX_HEAP) ? bytes : MAX_HEAP;
 }
 
 /* 
  * mem_sbrk - simple model of the sbrk function. Extends the heap 
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    by incr bytes and returns the start address of the new area. A
+ *    negative incr shrinks the heap (a compacting allocator gives
+ *    back the end of its heap this way), but not below its start.
+ *    Fails with ENOMEM, without a message, if the break would pass
+ *    its limit or the lowest segment: the caller may try mem_segment.
  */
 void *mem_sbrk(int incr) 
 {
     char *old_brk = mem_brk;
+    char *max_addr = mem_start_brk + mem_brk_limit;
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+    if (mem_num_segs > 0 && mem_seg_lo[mem_num_segs-1] < max_addr)
+	max_addr = mem_seg_lo[mem_num_segs-1];
+    if ( (mem_brk + incr < mem_start_brk) || ((mem_brk + incr) > max_addr)) {
 	errno = ENOMEM;
-	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
 	return (void *)-1;
     }
     mem_brk += incr;
     return (void *)old_brk;
 }
 
+/*
+ * mem_segment - hands out a new segment of at least size bytes, apart
+ *    from the break, and returns its start, which is page aligned.
+ *    Returns NULL if the reservation or the segment table is full.
+ */
+void *mem_segment(size_t size)
+{
+    char *lo, *hi;
+    size_t pagesize = mem_pagesize();
+
+    hi = (mem_num_segs > 0) ? mem_seg_lo[mem_num_segs-1] : mem_max_addr;
+    if (mem_num_segs == MAX_SEGMENTS || (size_t)(hi - mem_brk) < size ||
+	(lo = (char *)((unsigned long)(hi - size) & 
+		       ~((unsigned long)pagesize - 1))) < mem_brk) {
+	errno = ENOMEM;
+	fprintf(stderr, "ERROR: mem_segment failed. Ran out of memory...\n");
+	return NULL;
+    }
+    mem_seg_lo[mem_num_segs] = lo;
+    mem_seg_size[mem_num_segs] = hi - lo;
+    mem_num_segs++;
+    return (void *)lo;
+}
+
+/*
+ * mem_num_segments - returns the number of segments handed out since
+ *    the last mem_reset_brk
+ */
+int mem_num_segments()
+{
+    return mem_num_segs;
+}
+
+/*
+ * mem_segment_lo - return address of the first byte of segment i
+ */
+void *mem_segment_lo(int i)
+{
+    return (void *)mem_seg_lo[i];
+}
+
+/*
+ * mem_segment_hi - return address of the last byte of segment i
+ */
+void *mem_segment_hi(int i)
+{
+    return (void *)(mem_seg_lo[i] + mem_seg_size[i] - 1);
+}
+
+/*
+ * mem_map_region - maps a new region of size bytes, rounded up to
+ *    whole pages, and returns its start. Returns NULL, without a
+ *    message, if the region table is full, the heap would pass
+ *    MAX_HEAP, or mmap fails: the caller may use the heap instead.
+ */
+void *mem_map_region(size_t size)
+{
+    char *p;
+
+    size = mem_round_page(size);
+    if (mem_num_regs == MAX_REGIONS || mem_heapsize() + size > MAX_HEAP) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, 
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+	return NULL;
+    mem_reg_lo[mem_num_regs] = p;
+    mem_reg_size[mem_num_regs] = size;
+    mem_num_regs++;
+    return (void *)p;
+}
+
+/*
+ * mem_remap_region - resizes the region that starts at lo to size
+ *    bytes, rounded up to whole pages, and returns its new start. The
+ *    contents up to the smaller size are kept. With mremap the pages
+ *    move instead of being copied; elsewhere they are copied to a new
+ *    mapping. Returns NULL, leaving the region as it was, on failure.
+ */
+void *mem_remap_region(void *lo, size_t size)
+{
+    int i = mem_region_index((char *)lo);
+    size_t old_size = mem_reg_size[i];
+    char *p;
+
+    size = mem_round_page(size);
+    if (size > old_size && mem_heapsize() + (size - old_size) > MAX_HEAP) {
+	errno = ENOMEM;
+	return NULL;
+    }
+#ifdef MREMAP_MAYMOVE
+    p = mremap(lo, old_size, size, MREMAP_MAYMOVE);
+    if (p == MAP_FAILED)
+	return NULL;
+    if (size > old_size) {
+	mem_remaps++;
+	mem_remapped += old_size;
+    }
+#else
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, 
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+	return NULL;
+    memcpy(p, lo, (size < old_size) ? size : old_size);
+    munmap(lo, old_size);
+#endif
+    mem_reg_lo[i] = p;
+    mem_reg_size[i] = size;
+    return (void *)p;
+}
+
+/*
+ * mem_unmap_region - unmaps the region that starts at lo
+ */
+void mem_unmap_region(void *lo)
+{
+    int i = mem_region_index((char *)lo);
+
+    munmap(lo, mem_reg_size[i]);
+    mem_num_regs--;
+    mem_reg_lo[i] = mem_reg_lo[mem_num_regs];
+    mem_reg_size[i] = mem_reg_size[mem_num_regs];
+}
+
+/*
+ * mem_num_regions - returns the number of regions mapped now
+ */
+int mem_num_regions()
+{
+    return mem_num_regs;
+}
+
+/*
+ * mem_region_lo - return address of the first byte of region i
+ */
+void *mem_region_lo(int i)
+{
+    return (void *)mem_reg_lo[i];
+}
+
+/*
+ * mem_region_hi - return address of the last byte of region i
+ */
+void *mem_region_hi(int i)
+{
+    return (void *)(mem_reg_lo[i] + mem_reg_size[i] - 1);
+}
+
+/*
+ * mem_num_remaps - returns the number of times mem_remap_region grew
+ *    a region with mremap since the last mem_reset_brk
+ */
+unsigned long mem_num_remaps()
+{
+    return mem_remaps;
+}
+
+/*
+ * mem_remapped_bytes - returns the bytes that those mremap calls kept
+ *    in place, which a move by memcpy would have copied
+ */
+size_t mem_remapped_bytes()
+{
+    return mem_remapped;
+}
+
+/*
+ * mem_region_index - returns the index of the region that starts at lo
+ */
+static int mem_region_index(char *lo)
+{
+    int i;
+
+    for (i = 0; i < mem_num_regs; i++)
+	if (mem_reg_lo[i] == lo)
+	    return i;
+    fprintf(stderr, "ERROR: %p is not the start of a region\n", lo);
+    exit(1);
+}
+
+/*
+ * mem_round_page - size rounded up to whole pages
+ */
+static size_t mem_round_page(size_t size)
+{
+    size_t pagesize = mem_pagesize();
+
+    return (size + pagesize - 1) & ~(pagesize - 1);
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
@@ -85,11 +388,19 @@ void *mem_heap_hi()
 }
 
 /*
- * mem_heapsize() - returns the heap size in bytes
+ * mem_heapsize() - returns the heap size in bytes, segments and
+ *    regions included
  */
 size_t mem_heapsize() 
 {
-    return (size_t)(mem_brk - mem_start_brk);
+    size_t size = (size_t)(mem_brk - mem_start_brk);
+    int i;
+
+    for (i = 0; i < mem_num_segs; i++)
+	size += mem_seg_size[i];
+    for (i = 0; i < mem_num_regs; i++)
+	size += mem_reg_size[i];
+    return size;
 }
 
 /*
@@ -99,3 +410,56 @@ size_t mem_pagesize()
 {
     return (size_t)getpagesize();
 }
+
+/*
+ * mem_page_mode() - returns how the heap's pages were obtained
+ */
+const char *mem_page_mode()
+{
+    switch (mem_mode) {
+    case MEM_HUGETLB:
+	return "huge pages (MAP_HUGETLB)";
+    case MEM_THP:
+	return "transparent huge pages (MADV_HUGEPAGE)";
+    case MEM_MMAP:
+	return "normal pages (mmap)";
+    default:
+	return "normal pages (malloc)";
+    }
+}
+
+/*
+ * mem_hugepage_bytes() - returns the number of heap bytes that are
+ *    currently backed by huge pages, as reported for the heap mapping
+ *    in /proc/self/smaps, or 0 if that is not available
+ */
+size_t mem_hugepage_bytes()
+{
+    FILE *fp;
+    char line[256];
+    unsigned long lo, hi, kbytes;
+    int in_heap = 0;
+    size_t bytes = 0;
+
+    if (mem_mode == MEM_MALLOC)
+	return 0;
+    if ((fp = fopen("/proc/self/smaps", "r")) == NULL)
+	return 0;
+
+    /* Sum the huge page fields of the mappings inside the heap mapping */
+    while (fgets(line, sizeof(line), fp) != NULL) {
+	if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2) {
+	    in_heap = (lo >= (unsigned long)mem_map_start &&
+		       hi <= (unsigned long)mem_map_start + mem_map_size);
+	    continue;
+	}
+	if (!in_heap)
+	    continue;
+	if (sscanf(line, "AnonHugePages: %lu kB", &kbytes) == 1 ||
+	    sscanf(line, "Private_Hugetlb: %lu kB", &kbytes) == 1 ||
+	    sscanf(line, "Shared_Hugetlb: %lu kB", &kbytes) == 1)
+	    bytes += (size_t)kbytes * 1024;
+    }
+    fclose(fp);
+    return bytes;
+}
@@ -4,8 +4,23 @@ void mem_init(void);
 void mem_deinit(void);
 void *mem_sbrk(int incr);
 void mem_reset_brk(void); 
+void mem_set_brk_limit(size_t bytes);
+void *mem_segment(size_t size);
+int mem_num_segments(void);
+void *mem_segment_lo(int i);
+void *mem_segment_hi(int i);
+void *mem_map_region(size_t size);
+void *mem_remap_region(void *lo, size_t size);
+void mem_unmap_region(void *lo);
+int mem_num_regions(void);
+void *mem_region_lo(int i);
+void *mem_region_hi(int i);
+unsigned long mem_num_remaps(void);
+size_t mem_remapped_bytes(void);
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
 size_t mem_pagesize(void);
+const char *mem_page_mode(void);
+size_t mem_hugepage_bytes(void);
 
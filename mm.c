@@ -1,5 +1,5 @@
 /*
- * Malloc using explicit free list with first-fit
+ * Malloc using explicit free list with first-fit (LIFO or address-ordered skip list)
  */
 
 #include <stdio.h>
@@ -81,17 +81,174 @@ team_t team = {
 #define PREC_FREEP(bp)      (*(void**)(bp))         
 #define SUCC_FREEP(bp)      (*(void**)(bp + WSIZE))
 
-/* 
+/* free 블록의 노드 구조 */
+// free 리스트를 탐색할 때 읽는 값(prec, succ, 크기)을 payload 앞쪽의 연속된 세 워드에 모아둔다.
+// 탐색 중에는 header를 읽지 않고 이 세 워드만 읽으므로, 한 블록을 볼 때마다 건드리는 캐시 라인이 하나로 줄어든다.
+// 최소 블록(16바이트)에서는 이 자리가 footer와 겹치는데, footer의 값도 PACK(size, 0)이므로 그대로 크기로 읽힌다.
+// 24바이트 블록에는 크기와 skip list의 level, fwd[1]을 모두 담을 자리가 없으므로, 크기 대신 level(1 또는 2)을 이 자리에 둔다.
+// level은 MINIMUM보다 작으므로, 이 워드가 MINIMUM보다 작으면 24바이트 블록이다. (small node)
+#define NODE_WORD(bp)       (GET((char *)(bp) + (2 * WSIZE)))               // prec, succ 다음의 워드. 크기이거나, small node의 level이다.
+#define SMALL_NODE(bp)      (NODE_WORD(bp) < MINIMUM)                       // 크기 대신 level을 담은 24바이트 블록인지
+#define FREE_FITS(bp, asize) ((asize) <= NODE_WORD(bp) || ((asize) <= MINIMUM + DSIZE && SMALL_NODE(bp))) // asize가 free 블록 bp에 들어가는지. level은 asize보다 작으므로, 24바이트보다 큰 요청은 NODE_WORD와의 비교 한 번으로 끝난다.
+
+/* 소프트웨어 prefetch */
+// 리스트를 따라가는 동안 다음에 볼 블록을 미리 캐시로 불러와, 포인터를 따라갈 때마다 생기는 메모리 지연을 겹치게 한다.
+// 컴파일 시 -DFREE_PREFETCH=0 으로 끄고 mdriver로 비교할 수 있다.
+#ifndef FREE_PREFETCH
+#define FREE_PREFETCH       1
+#endif
+#if FREE_PREFETCH
+#define PREFETCH(p)         __builtin_prefetch(p)
+#define PREFETCHW(p)        __builtin_prefetch((p), 1)
+#else
+#define PREFETCH(p)
+#define PREFETCHW(p)
+#endif
+
+/* 통계 (mm_stats) */
+// 컴파일 시 -DMM_STATS=1 (make STATS=1) 로 켜면 mm_stats가 생기고, 힙 크기, free 블록 수, 분할, coalesce, 탐색 길이 등을 센다.
+// 끄면 STAT(...)은 아무 코드도 남기지 않으므로, 기본 빌드의 속도에는 영향이 없다.
+#ifndef MM_STATS
+#define MM_STATS            0
+#endif
+#if MM_STATS
+#define STAT(stmt)          do { stmt; } while (0)
+#else
+#define STAT(stmt)          do { } while (0)
+#endif
+
+/* free 리스트 삽입 정책 */
+// LIFO_ORDER는 free 블록을 리스트의 맨 앞에 넣는다. 삽입은 O(1)이지만 단편화가 심하다.
+// ADDRESS_ORDER는 free 리스트를 주소 오름차순으로 유지한다. first-fit과 함께 쓰면 단편화가 줄어든다.
+// 단순한 주소 정렬 삽입은 O(n)이므로, free 블록 안에 skip list를 만들어 삽입과 제거를 O(log n)으로 만든다.
+// 컴파일 시 -DFREE_ORDER=LIFO_ORDER 처럼 선택할 수 있다.
+#define LIFO_ORDER          0
+#define ADDRESS_ORDER       1
+#ifndef FREE_ORDER
+#define FREE_ORDER          ADDRESS_ORDER
+#endif
+
+/* skip list 관련 상수와 매크로 */
+// free 블록의 구조 : | header | prec | succ | size | fwd[1] | level | fwd[2] | fwd[3] | ... | footer |
+// 24바이트 블록(small node)의 구조 : | header | prec | succ | level | fwd[1] | footer |
+// fwd[1]은 어느 블록에서나 같은 자리에 있으므로, 탐색은 블록의 모양을 확인하지 않고 다음 블록으로 넘어간다.
+// 0층은 기존의 prec/succ 이중 연결리스트 그대로이고, 1층 이상은 fwd[k]로만 이어지는 단일 연결리스트이다.
+// MINIMUM(16바이트) 블록은 level 워드를 담을 자리가 없으므로 항상 0층에만 들어간다.
+// 작은 블록이 대부분인 힙에서도 24바이트 블록이 1층에 오를 수 있어야, 0층의 탐색이 최소 블록들 사이의 짧은 구간으로 끝난다.
+#define SKIP_MAXLEVEL       16                                              // skip list의 최대 층 수
+#define SKIP_LEVEL(bp)      (GET((char *)(bp) + ((SMALL_NODE(bp) ? 2 : 4) * WSIZE))) // 블록이 속한 층의 수(높이)
+#define SKIP_FWD(bp, k)     (*(void**)((char *)(bp) + (((k) == 1 ? 3 : 3 + (k)) * WSIZE))) // k층(k >= 1)에서의 다음 블록
+#define SKIP_CAPACITY(size) ((size) == MINIMUM + DSIZE ? 2 : ((size) / WSIZE) - 5) // 블록 크기가 허용하는 최대 높이. header, prec, succ, size, footer 5개의 워드를 제외한 나머지에 level과 fwd[1..]가 들어간다. (small node는 size가 없다.)
+
+/* realloc 성장 예측 */
+// mm_realloc으로 키워진 블록은 header의 비트 1을 켜둔다. 이 비트가 켜진 블록을 다시 키우면 반복해서 커지는 블록(문자열 빌더, 벡터 등)으로 본다.
+// 반복해서 커지는 블록은 옮길 때 기하급수적인 여유 공간(slack)을 얹어서, 다음 몇 번의 realloc은 복사 없이 제자리에서 끝나도록 한다.
+// 여유 공간을 받은 블록은 grow_bp에 기억해두었다가, free될 때 잊고 힙을 늘려야 할 만큼 메모리가 모자랄 때 여유 공간을 잘라 돌려준다.
+#define REALLOC_BIT         0x2                                             // header의 비트 1. mm_realloc으로 키워진 적이 있는 블록이다.
+#define GET_REALLOC(p)      (GET(p) & REALLOC_BIT)
+#define GROW_SLOTS          8                                               // 여유 공간을 받은 블록을 몇 개까지 기억할지
+#define GROW_SLACK(asize)   ALIGN((asize) / 2)                              // 옮길 때 얹어주는 여유 공간
+
+/* 다른 스레드에서의 해제 (remote free) */
+// 힙은 mm_init을 부른 스레드(owner)의 것이다. 다른 스레드가 mm_free를 부르면 free 리스트를 건드리지 않고,
+// 블록을 lock-free 스택(Treiber stack)인 remote_frees에 넣기만 한다. 다음 링크는 블록의 payload 첫 워드에 둔다.
+// owner는 다음 mm_malloc이나 mm_free에서 스택을 통째로 떼어내, 모인 블록들을 mm_free_batch처럼 한 번에 해제한다.
+// 스택에서 하나씩 꺼내는 일은 없으므로(통째로 교환할 뿐) ABA 문제가 생기지 않는다.
+// 다른 스레드의 mm_malloc, mm_realloc은 여전히 지원하지 않는다.
+#define REMOTE_NEXT(bp)     (*(void**)(bp))                                 // remote_frees에서 다음 블록
+#define REMOTE_PENDING()    (__atomic_load_n(&remote_frees, __ATOMIC_RELAXED) != NULL) // 쌓인 remote free가 있는지. 다른 스레드가 CAS로 쓰므로 원자적으로 읽는다.
+#define REMOTE_BATCH        64                                              // owner가 한 번에 해제하는 블록의 수
+#define HEAP_OWNER()        (owned_heap_id == heap_id)                      // 지금 스레드가 힙의 owner인지
+
+/* 핸들과 compaction */
+// mm_halloc으로 할당한 블록은 포인터 대신 핸들(handle_table의 번호 + 1)로 가리킨다. header의 비트 2를 켜서 표시하고,
+// payload의 첫 더블 워드에 핸들 번호를 적어둔다. (사용자의 payload는 그 뒤부터이다.)
+// mm_compact는 힙을 앞에서부터 훑으며 고정(pin)되지 않은 핸들 블록을 앞쪽의 빈 공간으로 당기고, 힙의 끝에 남은 빈 공간만큼 brk를 낮춘다.
+// 일반 블록과 고정된 핸들 블록은 움직이지 않는다. 핸들 블록은 mm_realloc으로 키울 수 없다.
+#define HANDLE_BIT          0x4                                             // header의 비트 2. 옮길 수 있는 핸들 블록이다.
+#define GET_HANDLE(p)       (GET(p) & HANDLE_BIT)
+#define HANDLE_ID(bp)       (GET(bp))                                       // 핸들 블록에 적어둔 핸들 번호
+#define HANDLE_INIT         64                                              // handle_table의 처음 크기
+#define HANDLE_VALID(h)     ((h) > 0 && (h) <= handle_cap && handle_table[(h) - 1].bp != NULL) // h가 할당된 핸들인지. 0이나 범위 밖, 해제된 핸들은 아니다.
+
+/* 큰 블록의 region */
+// 블록 크기가 map_min(기본값 MAP_THRESHOLD) 이상이면 힙 대신 memlib가 따로 매핑해 주는 region 하나에 둔다. (glibc의 mmap threshold와 같다.)
+// region의 첫 워드는 크기 0의 fencepost이고 그 다음 워드가 header이다. header의 크기는 region 전체의 크기이고, footer는 없다.
+// 힙의 블록 바로 앞에는 항상 크기가 0이 아닌 footer가 있으므로, bp 앞 더블 워드의 크기가 0이면 region의 블록이다.
+// mm_realloc은 region을 mremap으로 늘리거나 줄이므로, 큰 블록은 아무리 커져도 payload를 복사하지 않는다.
+#define MAP_THRESHOLD       (1<<17)                                         // 128kB
+#define MAPPED(bp)          (GET_SIZE((char *)(bp) - DSIZE) == 0)           // bp가 region의 블록인지
+
+typedef struct {
+    char *bp;                                                               // 핸들 블록 (빈 칸이면 NULL)
+    unsigned int pins;                                                      // mm_hlock 횟수. 빈 칸이면 다음 빈 칸의 핸들이다.
+} handle_entry_t;
+
+/*
  * global variable & functions
  */
 static char* heap_listp;                                                    // 항상 prologue block을 가리키는 정적 전역 변수 설정. static 변수는 함수 내부(지역)에서도 사용이 가능하고 함수 외부(전역)에서도 사용이 가능하다.
 static char* free_listp;                                                    // free list의 맨 첫 블록을 가리키는 포인터이다.
+static char* free_list_end;                                                 // free list의 끝을 나타내는 prologue 블록. 탐색은 header 대신 이 주소와 비교해 끝을 판단한다.
+static void* skip_head[SKIP_MAXLEVEL];                                      // 1층 이상에서 각 층의 맨 첫 블록을 가리키는 포인터이다. 0층의 맨 첫 블록은 free_listp이다.
+static unsigned int skip_seed;                                              // 블록의 높이를 정하는 난수 발생기의 상태
+static size_t chunksize = CHUNKSIZE;                                        // 힙을 늘릴 때의 최소 크기. mm_set_tunable로 바꿀 수 있다.
+static size_t split_min = 2 * DSIZE;                                        // 분할하고 남은 블록의 최소 크기. 이보다 작게 남으면 분할하지 않는다.
+static size_t map_min = MAP_THRESHOLD;                                      // 이 크기 이상의 블록은 region에 둔다.
+static size_t pending_chunksize = CHUNKSIZE;                                // mm_set_tunable로 정한 값들. 다음 mm_init에서 위의 변수들로 옮겨진다.
+static size_t pending_split_min = 2 * DSIZE;
+static size_t pending_map_min = MAP_THRESHOLD;
+static char* grow_bp[GROW_SLOTS];                                           // 여유 공간을 받은 블록들
+static size_t grow_need[GROW_SLOTS];                                        // ... 그리고 각 블록이 마지막 realloc에서 실제로 필요했던 크기
+static int grow_count;                                                      // grow_bp에서 사용 중인 칸의 수
+static unsigned int heap_id;                                                // mm_init을 부를 때마다 새로 매기는 힙의 번호
+static __thread unsigned int owned_heap_id;                                 // 이 스레드가 mm_init으로 만든 힙의 번호. 같으면 owner이다.
+static void* remote_frees;                                                  // 다른 스레드가 해제한 블록들의 스택
+static handle_entry_t* handle_table;                                        // 핸들 번호 - 1로 찾는 핸들 블록의 표. mm_malloc으로 할당한 일반 블록이다.
+static unsigned int handle_cap;                                             // handle_table의 칸 수
+static mm_handle_t handle_free;                                             // 빈 칸들의 연결 리스트의 첫 핸들 (없으면 0)
+#if MM_STATS
+static mm_stats_t stats;                                                    // mm_init 이후의 통계. heap_bytes와 live_bytes는 mm_stats에서 채운다.
+static size_t stat_free_bytes;                                              // free 리스트에 있는 블록들의 크기 합
+static unsigned long stat_steps;                                            // 지금 탐색에서 살펴본 free 블록의 수
+#endif
 
 /* 코드 순서상, implicit declaration of function(warning)을 피하기 위해 미리 선언해주는 부분? */
 static void* extend_heap(size_t words);
 static void* coalesce(void* bp);
 static void* find_fit(size_t asize);
+static void* find_fit_high(size_t asize);
 static void place(void* bp, size_t newsize);
+static void* place_high(void* bp, size_t asize);
+static void removeBlock(void* bp);
+static void putFreeBlock(void* bp);
+static int skip_height(void* bp);
+static int skip_random_level(size_t size);
+static void* skip_next(void* x, int k);
+static void skip_set_next(void* x, int k, void* next);
+static void* skip_find_prev(void* bp, void** update, int height);
+static int compare_addr(const void* a, const void* b);
+static void* grow_in_place(void* bp, size_t asize);
+static void shrink_block(void* bp, size_t asize);
+static void set_request_size(void* bp, size_t asize);
+static void grow_remember(void* bp, size_t asize);
+static void grow_forget(void* bp);
+static size_t grow_need_of(void* bp);
+static int grow_reclaim(void);
+static void free_batch(size_t n, void **ptrs);
+static void remote_free_push(void* bp);
+static void remote_free_drain(void);
+static void compact_fill(char* gap, size_t size);
+static char* compact_run(char* bp, char** end);
+static void* new_segment(size_t size);
+static void* map_block(size_t size);
+static void* map_resize(void* bp, size_t size);
+static void map_free(void* bp);
+#if MM_STATS
+static void stat_free_block(size_t size, int added);
+static void stat_search(void);
+static int stat_log2(size_t n);
+#endif
 
 int mm_init(void);
 void *mm_malloc(size_t size);
@@ -103,6 +260,11 @@ void *mm_realloc(void *ptr, size_t size);
  */
 int mm_init(void) {
     
+    // mm_set_tunable로 정한 값들은 이제부터 적용된다. 이미 있는 블록들이 중간에 다른 기준을 만나지 않게 하기 위함이다.
+    chunksize = pending_chunksize;
+    split_min = pending_split_min;
+    map_min = pending_map_min;
+    
     // unused padding, prologue header/prologue footer, prec, succ, epilogue_header 총 6개가 필요하다.
     if ((heap_listp = mem_sbrk(6*WSIZE)) == (void*)-1) {                    // 할당 실패 시 -1을 반환한다.
         return -1;
@@ -116,9 +278,26 @@ int mm_init(void) {
     PUT(heap_listp + (5 * WSIZE), PACK(0, 1));                              // epilogue header
     
     free_listp = heap_listp + 2 * WSIZE;                                    // free_listp를 탐색하는 메커니즘이다.
+    free_list_end = free_listp;
+
+    // skip list의 각 층을 비우고, 매 실행마다 같은 결과가 나오도록 난수 상태도 초기화한다.
+    memset(skip_head, 0, sizeof(skip_head));
+    skip_seed = 2463534242u;
+    grow_count = 0;
+    STAT(memset(&stats, 0, sizeof(stats)));
+    STAT(stat_free_bytes = 0);
+    STAT(stats.sbrk_calls = 1);                                             // 위의 mem_sbrk
     
+    // 이 스레드를 새 힙의 owner로 만든다. 이전 힙에 남아있던 remote free는 버린다.
+    heap_id++;
+    owned_heap_id = heap_id;
+    __atomic_store_n(&remote_frees, NULL, __ATOMIC_RELAXED);
+    handle_table = NULL;
+    handle_cap = 0;
+    handle_free = 0;
+
     // CHUCKSIZE만큼 힙을 확장해 초기 free 블록을 생성한다. 이 때 CHUCKSIZE는 2^12으로 4kB 정도였다.(4096 bytes)
-    if (extend_heap(CHUNKSIZE / WSIZE) == NULL) {                           // 곧바로 extend_heap이 실행된다.
+    if (extend_heap(chunksize / WSIZE) == NULL) {                           // 곧바로 extend_heap이 실행된다.
         return -1;
     }
     
@@ -135,9 +314,10 @@ static void* extend_heap(size_t words) {
     size = (words % 2 == 1) ? (words + 1) * WSIZE : (words) * WSIZE;        // words가 홀수로 들어왔다면 짝수로 바꿔준다. 짝수로 들어왔다면 그대로 WSIZE를 곱해준다. ex. 5만큼(5개의 워드 만큼) 확장하라고 하면, 6으로 만들고 24바이트로 만든다. 
                                                                             // 8바이트(2개 워드, 짝수) 정렬을 위해 짝수로 만들어줘야 한다.
     
+    STAT(stats.sbrk_calls++);
     if ((long)(bp = mem_sbrk(size)) == -1) {                                // 변환한 사이즈만큼 메모리 확보에 실패하면 NULL이라는 주소값을 반환해 실패했음을 알린다. bp 자체의 값, 즉 주소값이 32bit이므로 long으로 캐스팅한다.
-        return NULL;                                                        // 그리고 mem_sbrk 함수가 실행되므로 bp는 새로운 메모리의 첫 주소값을 가르키게 된다.
-    }              
+        return new_segment(size);                                           // brk를 더 늘릴 수 없으면 떨어진 segment를 받는다. 그것도 실패하면 NULL이다.
+    }                                                                       // 그리고 mem_sbrk 함수가 실행되므로 bp는 새로운 메모리의 첫 주소값을 가르키게 된다.
     
     // 새 free 블록의 header와 footer를 정해준다. 자연스럽게 전 epilogue 자리에는 새로운 header가 자리 잡게 된다. 그리고 epilogue는 맨 뒤로 보내지게 된다.
     PUT(HDRP(bp), PACK(size, 0));                                           // 새 free 블록의 header로, free 이므로 0을 부여
@@ -147,12 +327,97 @@ static void* extend_heap(size_t words) {
     return coalesce(bp);                                                    // 앞 뒤 블록이 free 블록이라면 연결하고 bp를 반환한다.
 }
 
+/*
+ * new_segment - brk를 더 늘릴 수 없을 때, memlib에서 brk와 떨어진 segment를 받아 size 바이트 이상의 free 블록 하나로 만든다.
+ *     segment의 앞에는 할당된 DSIZE짜리 fencepost 블록을, 끝에는 epilogue를 두어 coalesce가 segment의 경계를 넘지 않게 한다.
+ *     segment의 free 블록도 주소 순으로 free 리스트에 들어가며, 모든 탐색이 멈추는 끝 표지가 prologue(free_list_end)라는 점은 그대로다.
+ */
+static void* new_segment(size_t size) {
+    char* seg;
+    char* bp;
+    
+    size = MAX(size, mem_heapsize() / 8);                                   // segment도 힙을 따라 커지게 해서, segment 수가 힙 크기의 로그에 머물게 한다.
+    size = (size + 4 * WSIZE + mem_pagesize() - 1) & ~(mem_pagesize() - 1);  // padding, fencepost header/footer, epilogue만큼 더해 페이지 단위로 올린다.
+    if ((seg = mem_segment(size)) == NULL) {
+        return NULL;
+    }
+    
+    PUT(seg, 0);                                                            // unused padding
+    PUT(seg + (1 * WSIZE), PACK(DSIZE, 1));                                 // fencepost header
+    PUT(seg + (2 * WSIZE), PACK(DSIZE, 1));                                 // fencepost footer
+    bp = seg + (4 * WSIZE);
+    PUT(HDRP(bp), PACK(size - 4 * WSIZE, 0));
+    PUT(FTRP(bp), PACK(size - 4 * WSIZE, 0));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));                                   // segment의 epilogue header
+    
+    putFreeBlock(bp);                                                       // 앞뒤가 모두 할당된 것으로 보이므로 coalesce할 필요가 없다.
+    return bp;
+}
+
+/*
+ * map_block - payload가 size 바이트인 블록을 새 region에 만들어 반환한다. region을 받지 못하면 NULL을 반환한다.
+ */
+static void* map_block(size_t size) {
+    size_t len = (size + DSIZE + mem_pagesize() - 1) & ~(mem_pagesize() - 1); // fencepost와 header를 더해 페이지 단위로 올린다.
+    char* map;
+    
+    if ((map = mem_map_region(len)) == NULL) {
+        return NULL;
+    }
+    PUT(map, PACK(0, 1));                                                   // fencepost. MAPPED가 읽는 자리이다.
+    PUT(map + WSIZE, PACK(len, 1));                                         // header
+    return map + DSIZE;
+}
+
+/*
+ * map_resize - region의 블록 bp를 payload가 size 바이트가 되도록 mremap으로 늘리거나 줄이고, 옮겨진 bp를 반환한다.
+ *     페이지 수가 그대로면 아무 일도 하지 않는다. region을 늘릴 수 없으면 NULL을 반환하고, 블록은 그대로 남는다.
+ */
+static void* map_resize(void* bp, size_t size) {
+    size_t len = (size + DSIZE + mem_pagesize() - 1) & ~(mem_pagesize() - 1);
+    char* map;
+    
+    if (len == GET_SIZE(HDRP(bp))) {
+        return bp;
+    }
+    if ((map = mem_remap_region((char*)bp - DSIZE, len)) == NULL) {
+        return NULL;
+    }
+    PUT(map + WSIZE, PACK(len, 1));
+    return map + DSIZE;
+}
+
+/*
+ * map_free - region의 블록 bp를 region째로 돌려준다.
+ */
+static void map_free(void* bp) {
+    mem_unmap_region((char*)bp - DSIZE);
+}
+
 
 /*
  * mm_free - Freeing a block does nothing.
  */
 void mm_free(void *bp) {
-    size_t size = GET_SIZE(HDRP(bp));                                       // bp가 가리키는 블록의 사이즈만 들고 온다.
+    size_t size;
+    
+    if (!HEAP_OWNER()) {
+        remote_free_push(bp);                                               // owner가 아니면 스택에 넣기만 한다.
+        return;
+    }
+    if (REMOTE_PENDING()) {
+        remote_free_drain();
+    }
+    if (MAPPED(bp)) {
+        map_free(bp);                                                       // region은 통째로 돌려준다.
+        return;
+    }
+    
+    size = GET_SIZE(HDRP(bp));                                              // bp가 가리키는 블록의 사이즈만 들고 온다.
+    
+    if (grow_count > 0) {
+        grow_forget(bp);                                                    // 여유 공간을 받은 블록이었다면 잊는다.
+    }
     
     // header, footer 둘 다 flag를 0으로 바꿔주면 된다.
     PUT(HDRP(bp), PACK(size, 0));
@@ -161,6 +426,219 @@ void mm_free(void *bp) {
     coalesce(bp);                                                           // 앞 뒤 블록이 free 블록이라면 연결한다.                   
 }
 
+/*
+ * mm_set_tunable - 이름으로 정한 매개변수의 값을 바꾼다. 다음 mm_init부터 적용된다.
+ *     chunksize : 힙을 늘릴 때의 최소 크기 (기본값 CHUNKSIZE)
+ *     split     : 분할하고 남은 블록이 가져야 할 최소 크기 (기본값 2 * DSIZE, 이보다 작을 수는 없다.)
+ *     mapmin    : 이 크기 이상의 블록을 region에 둔다 (기본값 MAP_THRESHOLD, 0이면 region을 쓰지 않는다.)
+ *     모르는 이름이거나 허용되지 않는 값이면 -1을 반환한다.
+ */
+int mm_set_tunable(const char *name, long value) {
+    if (strcmp(name, "chunksize") == 0 && value >= 2 * DSIZE) {
+        pending_chunksize = ALIGN(value);
+        return 0;
+    }
+    if (strcmp(name, "split") == 0 && value >= 2 * DSIZE) {
+        pending_split_min = ALIGN(value);
+        return 0;
+    }
+    if (strcmp(name, "mapmin") == 0 && value >= 0) {
+        pending_map_min = (value > 0) ? (size_t)value : (size_t)-1;
+        return 0;
+    }
+    return -1;
+}
+
+/*
+ * mm_free_sized - 호출자가 알려준 요청 크기로 블록을 해제한다. (C++14의 sized delete)
+ *     오래 건드리지 않은 블록의 header는 캐시에 없기 쉬우므로 header를 읽지 않는다.
+ *     대신 요청 크기로 계산한 footer 자리를 읽는데, 이 word는 coalesce가 어차피 읽는 다음 블록의 header 바로 옆에 있다.
+ *     (place가 남는 공간을 블록에 붙였다면 그 자리에 실제 크기가 적혀 있다.)
+ */
+void mm_free_sized(void *bp, size_t size) {
+    size_t asize = ALIGN(size + SIZE_T_SIZE);                               // mm_malloc이 계산한 블록 크기
+    
+    if (!HEAP_OWNER()) {
+        remote_free_push(bp);
+        return;
+    }
+    if (REMOTE_PENDING()) {
+        remote_free_drain();
+    }
+    if (MAPPED(bp)) {
+        map_free(bp);
+        return;
+    }
+    
+    size = GET_SIZE((char *)bp + asize - DSIZE);                            // 실제 블록 크기
+    
+    if (grow_count > 0) {
+        grow_forget(bp);
+    }
+    
+    PUT(HDRP(bp), PACK(size, 0));
+    PUT(FTRP(bp), PACK(size, 0));
+    
+    coalesce(bp);
+}
+
+/*
+ * mm_malloc_batch - size 바이트 블록 n개를 한 번에 할당해 out에 담고, 할당한 블록의 수를 반환한다. (실패 시 0)
+ *     n개가 모두 들어가는 free 블록 하나(없으면 extend_heap 한 번으로 만든 블록)를 앞에서부터 잘라 쓰므로,
+ *     free 리스트는 블록 하나의 제거와 남은 블록 하나의 삽입으로 끝난다.
+ */
+size_t mm_malloc_batch(size_t n, size_t size, void **out) {
+    size_t asize;                                                           // 블록 하나의 크기
+    size_t total;                                                           // n개 블록의 크기를 모두 더한 값
+    size_t csize;                                                           // 잘라 쓸 free 블록의 크기
+    size_t i;
+    char *bp;
+    
+    if (n == 0 || size == 0) {
+        return 0;
+    }
+    if (REMOTE_PENDING()) {
+        remote_free_drain();
+    }
+    
+    asize = ALIGN(size + SIZE_T_SIZE);
+    total = n * asize;
+    
+    if ((bp = find_fit(total)) == NULL) {
+        if ((bp = extend_heap(MAX(total, chunksize) / WSIZE)) == NULL) {
+            return 0;
+        }
+    }
+    
+    csize = GET_SIZE(HDRP(bp));
+    removeBlock(bp);
+    
+    // 남는 공간이 free 블록을 만들 수 없을 만큼 작다면 마지막 블록이 가져간다. (place와 같은 기준이다.)
+    if ((csize - total) < split_min) {
+        total = csize;
+    }
+    
+    // 앞에서부터 asize씩 잘라 할당한다. 잘라낸 블록들은 free 리스트를 거치지 않는다.
+    for (i = 0; i < n; i++) {
+        out[i] = bp;
+        if (i == n - 1 && total > n * asize) {
+            PUT(bp + asize - DSIZE, PACK(total - (n - 1) * asize, 1));      // place처럼 요청 크기의 footer 자리에도 실제 크기를 적어둔다.
+            asize = total - (n - 1) * asize;
+        }
+        PUT(HDRP(bp), PACK(asize, 1));
+        PUT(FTRP(bp), PACK(asize, 1));
+        bp = NEXT_BLKP(bp);
+    }
+    
+    // 남은 공간은 free 블록 하나로 만들어 free 리스트에 한 번만 넣는다.
+    if (csize > total) {
+        PUT(HDRP(bp), PACK(csize - total, 0));
+        PUT(FTRP(bp), PACK(csize - total, 0));
+        putFreeBlock(bp);
+    }
+    
+    return n;
+}
+
+/*
+ * mm_free_batch - 블록 n개를 한 번에 해제한다. ptrs 배열은 주소 순으로 정렬된다.
+ *     주소 순으로 보면서 서로 맞닿은 블록들은 먼저 하나로 합치고, 합친 블록마다 coalesce를 한 번만 한다.
+ */
+void mm_free_batch(size_t n, void **ptrs) {
+    size_t i;
+    
+    if (!HEAP_OWNER()) {
+        for (i = 0; i < n; i++) {
+            remote_free_push(ptrs[i]);
+        }
+        return;
+    }
+    if (REMOTE_PENDING()) {
+        remote_free_drain();
+    }
+    
+    free_batch(n, ptrs);
+}
+
+/*
+ * free_batch - mm_free_batch의 본체. owner 스레드에서만 부른다.
+ */
+static void free_batch(size_t n, void **ptrs) {
+    size_t i;
+    size_t size;
+    char *bp;
+    
+    qsort(ptrs, n, sizeof(void *), compare_addr);
+    
+    if (grow_count > 0) {
+        for (i = 0; i < n; i++) {
+            grow_forget(ptrs[i]);
+        }
+    }
+    
+    for (i = 0; i < n; i++) {
+        bp = ptrs[i];
+        if (MAPPED(bp)) {
+            map_free(bp);
+            continue;
+        }
+        size = GET_SIZE(HDRP(bp));
+        
+        // 바로 뒤 블록도 이번에 해제할 블록이라면 크기만 더해 하나의 블록으로 만든다. (바로 뒤에 매핑된 region의 블록은 제외한다.)
+        while (i + 1 < n && (char *)ptrs[i + 1] == bp + size && !MAPPED(ptrs[i + 1])) {
+            i++;
+            size += GET_SIZE(HDRP(ptrs[i]));
+        }
+        
+        PUT(HDRP(bp), PACK(size, 0));
+        PUT(FTRP(bp), PACK(size, 0));
+        coalesce(bp);                                                       // 합친 블록의 앞 뒤가 free 블록이라면 연결하고, free 리스트에 한 번 넣는다.
+    }
+}
+
+/*
+ * remote_free_push - owner가 아닌 스레드에서 해제한 블록 bp를 remote_frees 스택에 넣는다. (lock-free)
+ */
+static void remote_free_push(void* bp) {
+    void *head = __atomic_load_n(&remote_frees, __ATOMIC_RELAXED);
+    
+    do {
+        REMOTE_NEXT(bp) = head;
+    } while (!__atomic_compare_exchange_n(&remote_frees, &head, bp, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*
+ * remote_free_drain - remote_frees 스택을 통째로 떼어내, 모인 블록들을 REMOTE_BATCH개씩 free_batch로 해제한다.
+ */
+static void remote_free_drain(void) {
+    void *batch[REMOTE_BATCH];
+    size_t n = 0;
+    void *bp = __atomic_exchange_n(&remote_frees, NULL, __ATOMIC_ACQUIRE);
+    
+    while (bp != NULL) {
+        batch[n++] = bp;
+        bp = REMOTE_NEXT(bp);                                               // free_batch가 payload를 덮어쓰기 전에 다음 링크를 읽는다.
+        if (n == REMOTE_BATCH) {
+            free_batch(n, batch);
+            n = 0;
+        }
+    }
+    if (n > 0) {
+        free_batch(n, batch);
+    }
+}
+
+/*
+ * compare_addr - mm_free_batch에서 qsort로 블록 포인터를 주소 순으로 정렬하기 위한 비교 함수
+ */
+static int compare_addr(const void* a, const void* b) {
+    char *pa = *(char **)a;
+    char *pb = *(char **)b;
+    
+    return (pa > pb) - (pa < pb);
+}
+
 /*
  * coalesce - 이전 혹은 다음 블록이 free이면 연결시키고, 경우에 따라 free 리스트에서 제거하고 새로워진 free 블록을 free 리스트에 추가한다.
  */
@@ -171,11 +649,13 @@ static void* coalesce(void* bp) {
     
     // 경우 1. 이전 블록 할당, 다음 블록 할당 - 연결시킬 수 없으니 그대로 bp를 반환한다.
     if (prev_alloc && next_alloc) {
+        STAT(stats.coalesce[0]++);
         putFreeBlock(bp);
         return bp;
     }
     
     else if (prev_alloc && !next_alloc) {
+        STAT(stats.coalesce[1]++);
         removeBlock(NEXT_BLKP(bp));                                         // free 상태였던 다음 블록을 free 리스트에서 제거한다.
         size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
         PUT(HDRP(bp), PACK(size, 0));
@@ -183,6 +663,7 @@ static void* coalesce(void* bp) {
     }
     
     else if (!prev_alloc && next_alloc) {
+        STAT(stats.coalesce[2]++);
         removeBlock(PREV_BLKP(bp));                                         // free 상태였던 이전 블록을 free 리스트에서 제거한다.
         size += GET_SIZE(HDRP(PREV_BLKP(bp)));
         bp = PREV_BLKP(bp);
@@ -191,6 +672,7 @@ static void* coalesce(void* bp) {
     }
     
     else {
+        STAT(stats.coalesce[3]++);
         removeBlock(PREV_BLKP(bp));                                         // free 상태였던 이전 블록을 free 리스트에서 제거한다.
         removeBlock(NEXT_BLKP(bp));                                         // free 상태였던 다음 블록을 free 리스트에서 제거한다.
         size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
@@ -216,9 +698,17 @@ void *mm_malloc(size_t size) {
     if (size == 0) {
         return NULL;                                                        // 가짜 요청은 무시한다.
     }
+    if (REMOTE_PENDING()) {
+        remote_free_drain();                                                // 다른 스레드가 해제한 블록들을 먼저 돌려받는다.
+    }
     
     asize = ALIGN(size + SIZE_T_SIZE);                                      // header와 footer를 위한 메모리, 즉 word 2개가 필요하므로 SIZE_T_SIZE만큼의 메모리가 필요하다. 여기에 현재 할당하려는 size를 더하면, header와 footer가 포함되면서 할당하려는 블록의 크기가 된다.
     
+    // 큰 블록은 region에 둔다. region을 받지 못하면 힙에 둔다.
+    if (asize >= map_min && (bp = map_block(size)) != NULL) {
+        return bp;
+    }
+    
     // 적절한 공간을 가진 블록을 찾으면 할당(혹은 분할까지) 진행한다.
     // bp는 계속 free 블록을 가리킬 수 있도록 한다.
     if ((bp = find_fit(asize)) != NULL) {
@@ -226,8 +716,14 @@ void *mm_malloc(size_t size) {
         return bp;
     }
     
+    // 힙을 늘리기 전에, realloc으로 얹어준 여유 공간을 돌려받아 다시 찾아본다.
+    if (grow_count > 0 && grow_reclaim() && (bp = find_fit(asize)) != NULL) {
+        place(bp, asize);
+        return bp;
+    }
+    
     // 적절한 공간을 찾지 못했다면 힙을 늘려주고, 그 늘어난 공간에 할당시켜야 한다.
-    extendsize = MAX(asize, CHUNKSIZE);                                     // 둘 중 더 큰 값을 선택한다.
+    extendsize = MAX(asize, chunksize);                                     // 둘 중 더 큰 값을 선택한다.
     if ((bp = extend_heap(extendsize / WSIZE)) == NULL) {                   // 실패 시 bp로는 NULL을 반환한다.
         return NULL;
     }
@@ -237,6 +733,41 @@ void *mm_malloc(size_t size) {
     return bp;
 }
 
+/*
+ * mm_malloc_hint - 수명 힌트를 받아 할당한다. 짧게 사는 블록과 힌트가 없는 블록은 mm_malloc과 같이 힙의 앞쪽부터 찾는다.
+ *     오래 사는 블록과 영구 블록은 힙의 뒤쪽부터 찾아 free 블록의 뒷부분에 놓는다.
+ *     그러면 오래 사는 블록들은 힙의 끝쪽에 모이고, 짧게 사는 블록들이 해제되며 남긴 구멍 사이에 끼어 그 구멍들을 붙잡지 않는다.
+ *     주소 정렬 정책(ADDRESS_ORDER)에서만 의미가 있다.
+ */
+void *mm_malloc_hint(size_t size, mm_hint_t hint) {
+    size_t asize;
+    char *bp;
+    
+    if ((hint != MM_HINT_LONG && hint != MM_HINT_PERMANENT) || ALIGN(size + SIZE_T_SIZE) >= map_min) {
+        return mm_malloc(size);                                             // 큰 블록은 수명과 상관없이 region에 둔다.
+    }
+    if (size == 0) {
+        return NULL;
+    }
+    if (REMOTE_PENDING()) {
+        remote_free_drain();
+    }
+    
+    asize = ALIGN(size + SIZE_T_SIZE);
+    if ((bp = find_fit_high(asize)) != NULL) {
+        return place_high(bp, asize);
+    }
+    if (grow_count > 0 && grow_reclaim() && (bp = find_fit_high(asize)) != NULL) {
+        return place_high(bp, asize);
+    }
+    
+    // 늘어난 공간의 뒷부분에 놓는다. 앞부분은 짧게 사는 블록들이 쓴다.
+    if ((bp = extend_heap(MAX(asize, chunksize) / WSIZE)) == NULL) {
+        return NULL;
+    }
+    return place_high(bp, asize);
+}
+
 /*
  * find_fit - first-fit, free 리스트의 맨 처음부터 탐색하여 요구하는 메모리 공간보다 큰 free 블록의 주소를 반환한다.
  */
@@ -244,12 +775,37 @@ static void* find_fit(size_t asize) {
     void* bp;
     
     // free 리스트의 맨 마지막은 할당되어진 prologue 블록(정확히는 payload를 가리키는, free 블록이었으면 prev이었을 워드를 가리키고 있다)이다.
-    for (bp = free_listp; GET_ALLOC(HDRP(bp)) != 1; bp = SUCC_FREEP(bp)) {
-        if (asize <= GET_SIZE(HDRP(bp))) {
+    // header 대신 노드 안의 크기를 읽고, 크기를 비교하는 동안 다음 블록을 미리 불러온다.
+    for (bp = free_listp; bp != free_list_end; bp = SUCC_FREEP(bp)) {
+        PREFETCH(SUCC_FREEP(bp));
+        STAT(stat_steps++);
+        if (FREE_FITS(bp, asize)) {
+            STAT(stat_search());
+            return bp;
+        }
+    }
+    
+    STAT(stat_search());
+    return NULL;
+}
+
+/*
+ * find_fit_high - last-fit, free 리스트의 맨 끝(주소가 가장 높은 블록)부터 거꾸로 탐색하여 요구하는 메모리 공간보다 큰 free 블록의 주소를 반환한다.
+ */
+static void* find_fit_high(size_t asize) {
+    void* bp;
+    
+    // 리스트의 끝을 나타내는 prologue 블록의 prec은 리스트의 마지막 블록을, 맨 첫 블록의 prec은 NULL을 가리킨다.
+    for (bp = PREC_FREEP(free_list_end); bp != NULL; bp = PREC_FREEP(bp)) {
+        PREFETCH(PREC_FREEP(bp));
+        STAT(stat_steps++);
+        if (FREE_FITS(bp, asize)) {
+            STAT(stat_search());
             return bp;
         }
     }
     
+    STAT(stat_search());
     return NULL;
 }
 
@@ -265,7 +821,9 @@ static void place(void* bp, size_t asize) {
     // 분할이 가능한 경우
     // 할당하고 남은 메모리가 free 블록을 만들 수 있는 4개의 word가 되느냐
     // header/footer/prec/next가 필요하니 최소 4개의 word는 필요하다.
-    if ((csize - asize) >= (2 * DSIZE)) {
+    if ((csize - asize) >= split_min) {
+        STAT(stats.splits++);
+        
         // 앞의 블록은 할당시킨다.
         PUT(HDRP(bp), PACK(asize, 1));
         PUT(FTRP(bp), PACK(asize, 1));
@@ -283,13 +841,63 @@ static void place(void* bp, size_t asize) {
     } else {
         PUT(HDRP(bp), PACK(csize, 1));
         PUT(FTRP(bp), PACK(csize, 1));
+        
+        // 요청한 크기로 계산한 footer 자리에도 실제 크기를 적어둔다. (mm_free_sized가 header 대신 읽는다.)
+        // 이 자리는 payload 뒤의 남는 공간이라 사용자가 쓰지 않는다.
+        if (csize > asize) {
+            PUT((char *)bp + asize - DSIZE, PACK(csize, 1));
+        }
     }
 }
 
+/*
+ * place_high - place와 같지만, 분할할 때 free 블록의 뒷부분을 할당하고 앞부분을 free 블록으로 남긴다. 할당한 블록을 반환한다.
+ */
+static void* place_high(void* bp, size_t asize) {
+    size_t csize = GET_SIZE(HDRP(bp));
+    
+    if ((csize - asize) < split_min) {
+        place(bp, asize);
+        return bp;
+    }
+    
+    // 남는 앞부분은 크기가 바뀌어 skip list의 높이도 달라질 수 있으므로, 빼냈다가 다시 넣는다.
+    STAT(stats.splits++);
+    removeBlock(bp);
+    PUT(HDRP(bp), PACK(csize - asize, 0));
+    PUT(FTRP(bp), PACK(csize - asize, 0));
+    putFreeBlock(bp);
+    
+    bp = NEXT_BLKP(bp);
+    PUT(HDRP(bp), PACK(asize, 1));
+    PUT(FTRP(bp), PACK(asize, 1));
+    return bp;
+}
+
 /*
  * removeBlock - 할당되거나, 이전 혹은 다음 블록과 연결되어지는 free 블록은 free 리스트에서 제거해야 한다.
  */
-void removeBlock(void *bp) {
+static void removeBlock(void *bp) {
+    void* update[SKIP_MAXLEVEL];
+    int height;
+    int k;
+
+    STAT(stat_free_block(GET_SIZE(HDRP(bp)), 0));
+
+    // 0층에서 고쳐야 할 앞 뒤 블록의 link 워드를 미리 불러와, skip list 탐색과 겹치게 한다.
+    PREFETCHW(PREC_FREEP(bp));
+    PREFETCHW(SUCC_FREEP(bp));
+
+    // 주소 정렬 정책이라면 1층 이상의 skip list에서 먼저 bp를 떼어낸다.
+    // 1층 이상은 단일 연결리스트이므로, 각 층에서 bp 바로 앞의 블록을 위에서부터 찾아 내려온다. O(log n)
+    if (FREE_ORDER == ADDRESS_ORDER && (height = skip_height(bp)) > 1) {
+        skip_find_prev(bp, update, height);
+        for (k = 1; k < height; k++) {
+            skip_set_next(update[k], k, SKIP_FWD(bp, k));
+        }
+    }
+
+    // 0층은 이중 연결리스트이므로 앞 뒤의 블록만 이어주면 된다.
     // free 리스트의 첫 번째 블록을 없앨 때
     // ex. (참고로 PREC, SUCC word 안에는 주소값, 즉 포인터가 들어있다는 것을 유심해야 한다.)
     // 0x72 <-> 0x24 <-> 0x08   맨 처음, bp(free_listp)가 0x72를 가리키고 있다고 가정.
@@ -311,39 +919,605 @@ void removeBlock(void *bp) {
 }
 
 /*
- * putFreeBlock - free 되거나, 연결되어 새롭게 수정된 free 블록을 free 리스트의 맨 처음에 넣는다.
+ * putFreeBlock - free 되거나, 연결되어 새롭게 수정된 free 블록을 free 리스트에 넣는다.
+ *     LIFO_ORDER라면 맨 처음에, ADDRESS_ORDER라면 skip list를 타고 내려가 주소 순서에 맞는 자리에 넣는다.
+ */
+static void putFreeBlock(void* bp) {
+    void* update[SKIP_MAXLEVEL];
+    void* prev;
+    void* next;
+    int height;
+    int k;
+
+    // 탐색할 때 읽을 크기를 link 옆에 적어둔다. small node는 그 자리에 level을 적으므로, 일단 1층으로 둔다.
+    NODE_WORD(bp) = (GET_SIZE(HDRP(bp)) == MINIMUM + DSIZE) ? 1 : GET_SIZE(HDRP(bp));
+    STAT(stat_free_block(GET_SIZE(HDRP(bp)), 1));
+
+    if (FREE_ORDER == LIFO_ORDER) {
+        SUCC_FREEP(bp) = free_listp;                                        // 이제 bp 블록의 다음은 free_listp가 되게 된다.
+        PREC_FREEP(bp) = NULL;                                              // free 리스트의 맨 처음 블록의 이전 블록은 당연히 NULL이어야 한다.
+        PREC_FREEP(free_listp) = bp;                                        // free_listp, 즉 bp의 다음 블록의 이전(PREC)이 bp를 향하도록 한다. free_listp가 밀려난 셈이니까.
+        free_listp = bp;                                                    // 이제 free 리스트의 맨 처음을 가리키는 포인터인 free_listp를 bp로 바꿔준다. 이제 bp는 완벽히 free 리스트의 맨 처음이 되었다.
+        return;
+    }
+
+    // 블록의 높이를 정하고, level 워드가 있는 블록이라면 기록해둔다. (제거할 때 다시 읽어야 하기 때문이다.)
+    height = skip_random_level(GET_SIZE(HDRP(bp)));
+    if (GET_SIZE(HDRP(bp)) > MINIMUM) {
+        SKIP_LEVEL(bp) = height;
+    }
+
+    // 각 층에서 bp보다 주소가 작은 마지막 블록(update[k])과 0층에서의 바로 앞 블록(prev)을 찾는다.
+    prev = skip_find_prev(bp, update, height);
+
+    // 1층 이상은 update[k]와 그 다음 블록 사이에 bp를 끼워 넣는다.
+    for (k = 1; k < height; k++) {
+        SKIP_FWD(bp, k) = skip_next(update[k], k);
+        skip_set_next(update[k], k, bp);
+    }
+
+    // 0층은 prev와 그 다음 블록 사이에 bp를 끼워 넣는다. prev가 NULL이면 리스트의 맨 처음이다.
+    next = (prev == NULL) ? free_listp : SUCC_FREEP(prev);
+    SUCC_FREEP(bp) = next;
+    PREC_FREEP(bp) = prev;
+    PREC_FREEP(next) = bp;                                                  // next는 free 블록이거나, 리스트의 끝을 나타내는 prologue 블록이다.
+    if (prev == NULL) {
+        free_listp = bp;
+    } else {
+        SUCC_FREEP(prev) = bp;
+    }
+}
+
+/*
+ * skip_height - free 리스트 안에 있는 블록 bp가 몇 개의 층에 걸쳐 있는지 반환한다.
+ */
+static int skip_height(void* bp) {
+    // MINIMUM 블록의 세 번째 워드는 footer이므로 읽으면 안 된다.
+    if (GET_SIZE(HDRP(bp)) <= MINIMUM) {
+        return 1;
+    }
+    return SKIP_LEVEL(bp);
+}
+
+/*
+ * skip_random_level - 1/2 확률로 한 층씩 올라가는 높이를 정한다. 블록이 담을 수 있는 높이를 넘지 않는다.
+ */
+static int skip_random_level(size_t size) {
+    int height = 1;
+    int capacity;
+
+    if (size <= MINIMUM) {
+        return 1;
+    }
+
+    capacity = SKIP_CAPACITY(size);
+    if (capacity > SKIP_MAXLEVEL) {
+        capacity = SKIP_MAXLEVEL;
+    }
+
+    // xorshift32 난수 발생기로, 비트를 하나씩 소비하며 층을 올린다.
+    skip_seed ^= skip_seed << 13;
+    skip_seed ^= skip_seed >> 17;
+    skip_seed ^= skip_seed << 5;
+    while (height < capacity && (skip_seed >> (height - 1)) & 1) {
+        height++;
+    }
+
+    return height;
+}
+
+/*
+ * skip_next - k층(k >= 1)에서 x의 다음 블록을 반환한다. x가 NULL이면 그 층의 맨 처음 블록을 반환한다.
  */
-void putFreeBlock(void* bp) {
-    SUCC_FREEP(bp) = free_listp;                                            // 이제 bp 블록의 다음은 free_listp가 되게 된다.
-    PREC_FREEP(bp) = NULL;                                                  // free 리스트의 맨 처음 블록의 이전 블록은 당연히 NULL이어야 한다.
-    PREC_FREEP(free_listp) = bp;                                            // free_listp, 즉 bp의 다음 블록의 이전(PREC)이 bp를 향하도록 한다. free_listp가 밀려난 셈이니까.
-    free_listp = bp;                                                        // 이제 free 리스트의 맨 처음을 가리키는 포인터인 free_listp를 bp로 바꿔준다. 이제 bp는 완벽히 free 리스트의 맨 처음이 되었다.
+static void* skip_next(void* x, int k) {
+    return (x == NULL) ? skip_head[k] : SKIP_FWD(x, k);
+}
+
+/*
+ * skip_set_next - k층(k >= 1)에서 x의 다음 블록을 next로 바꾼다. x가 NULL이면 그 층의 맨 처음을 바꾼다.
+ */
+static void skip_set_next(void* x, int k, void* next) {
+    if (x == NULL) {
+        skip_head[k] = next;
+    } else {
+        SKIP_FWD(x, k) = next;
+    }
+}
+
+/*
+ * skip_find_prev - 맨 위층부터 내려오면서, 각 층에서 bp보다 주소가 작은 마지막 블록을 update[k]에 담는다.
+ *     height층 미만의 update만 채우며, 0층에서 bp 바로 앞의 블록을 반환한다. (없으면 NULL)
+ */
+static void* skip_find_prev(void* bp, void** update, int height) {
+    void* x = NULL;                                                         // NULL은 각 층의 맨 앞(head)을 뜻한다.
+    void* next;
+    int k;
+
+    for (k = SKIP_MAXLEVEL - 1; k >= 1; k--) {
+        while ((next = skip_next(x, k)) != NULL && (char *)next < (char *)bp) {
+            PREFETCH(SKIP_FWD(next, k));
+            x = next;
+        }
+        if (k < height) {
+            update[k] = x;
+        }
+    }
+
+    // 0층은 prologue 블록(할당된 블록)을 만나면 끝이다. 위층에서 찾은 x부터 이어서 탐색하므로 짧게 끝난다.
+    next = (x == NULL) ? free_listp : SUCC_FREEP(x);
+    while (next != free_list_end && (char *)next < (char *)bp) {
+        PREFETCH(SUCC_FREEP(next));
+        x = next;
+        next = SUCC_FREEP(next);
+    }
+
+    return x;
 }
 
 /*
- * mm_realloc - Implemented simply in terms of mm_malloc and mm_free
+ * mm_realloc - 블록을 제자리에서 키우거나 줄일 수 있으면 복사 없이 끝내고, 아니면 새 블록으로 옮긴다.
+ *     제자리에서 키울 수 있는 경우는 (1) 이미 받아둔 여유 공간으로 충분하거나, (2) 바로 뒤의 free 블록을 합치면 충분하거나,
+ *     (3) 블록이 힙의 끝에 있어 모자란 만큼만 힙을 늘리면 되는 경우이다.
+ *     반복해서 커지는 블록을 옮길 때는 여유 공간을 얹어주고, 맞는 free 블록이 없으면 힙의 끝에 두어 이후에는 (3)으로 자라게 한다.
  */
 void *mm_realloc(void *ptr, size_t size) {
-    // 블록의 크기를 줄이는 것이면 줄이려는 size만큼으로 줄인다.
-    // 블록의 크기를 늘리는 것이면 
-    // 핵심은, 이미 할당된 블록의 사이즈를 직접 건드리는 것이 아니라, 요청한 사이즈 만큼의 블록을 새로 메모리 공간에 만들고 현재의 블록을 반환하는 것이다.
-    // 해당 블록의 사이즈가 이 정도로 변경되었으면 좋겠다는 것이 size, 
     void *oldptr = ptr;                                                     // 크기를 조절하고 싶은 힙의 시작 포인터
     void *newptr;                                                           // 크기 조절 뒤의 새 힙의 시작 포인터
-    size_t copySize;                                                        // 복사할 힙의 크기
+    size_t asize;                                                           // 요청한 size에 맞는 블록 크기
+    size_t csize;                                                           // 원래 블록의 크기
+    size_t copySize;                                                        // 복사할 payload의 크기
+    int repeated;                                                           // 전에도 realloc으로 키워진 블록인지
     
-    newptr = mm_malloc(size);                                               // place를 통해 header, footer가 배정된다.
-    if (newptr == NULL) {
+    if (ptr == NULL) {
+        return mm_malloc(size);
+    }
+    if (size == 0) {
+        mm_free(ptr);
         return NULL;
     }
     
-    copySize = GET_SIZE(HDRP(oldptr));                                      // 원래 블록의 사이즈
+    // region의 블록은 mremap으로 크기를 바꾼다. 주소는 바뀔 수 있지만 payload는 복사되지 않는다.
+    // region을 늘릴 수 없을 때만 힙으로 옮기며 복사한다.
+    if (MAPPED(oldptr)) {
+        if ((newptr = map_resize(oldptr, size)) != NULL) {
+            return newptr;
+        }
+        if ((newptr = mm_malloc(size)) == NULL) {
+            return NULL;
+        }
+        copySize = GET_SIZE(HDRP(oldptr)) - DSIZE;                          // region의 payload 크기 (fencepost와 header를 뺀다.)
+        if (size < copySize) {
+            copySize = size;
+        }
+        STAT(stats.realloc_copied += copySize);
+        memcpy(newptr, oldptr, copySize);
+        map_free(oldptr);
+        return newptr;
+    }
+    
+    asize = ALIGN(size + SIZE_T_SIZE);
+    csize = GET_SIZE(HDRP(oldptr));
+    repeated = GET_REALLOC(HDRP(oldptr));
     
-    if (size < copySize) {                                                  // 만약 블록의 크기를 줄이는 것이라면 size만큼으로 줄이면 된다. copySize - size 공간의 데이터는 잘리게 된다. 밑의 memcpy에서 잘린 만큼의 데이터는 복사되지 않는다.
+    // 줄이거나 여유 공간 안에서 키우는 경우. 반복해서 커지는 블록은 여유 공간을 그대로 두고, 아니면 남는 부분을 돌려준다.
+    // 반복해서 커지던 블록이라도 절반 아래로 줄어들면 더는 자라는 블록으로 보지 않는다.
+    if (asize <= csize) {
+        if (repeated && asize < csize / 2) {
+            PUT(HDRP(oldptr), GET(HDRP(oldptr)) & ~REALLOC_BIT);
+            repeated = 0;
+            if (grow_count > 0) {
+                grow_forget(oldptr);
+            }
+        }
+        if (!repeated) {
+            shrink_block(oldptr, asize);
+        }
+        set_request_size(oldptr, asize);
+        if (repeated && grow_count > 0) {
+            grow_forget(oldptr);
+            grow_remember(oldptr, asize);
+        }
+        return oldptr;
+    }
+    
+    // 뒤의 free 블록을 합치거나 힙의 끝에서 늘려 제자리에서 키우는 경우
+    if (grow_in_place(oldptr, asize) != NULL) {
+        if (grow_count > 0) {
+            grow_forget(oldptr);                                            // 여유 공간을 다 쓰고 딱 맞게 커졌다.
+        }
+        return oldptr;
+    }
+    
+    // 옮겨야 하는 경우. 원래 블록의 여유 공간은 복사할 필요가 없으므로, 마지막 realloc에서 필요했던 크기의 payload만 복사한다.
+    copySize = grow_need_of(oldptr) - DSIZE;                                // header와 footer를 뺀다.
+    if (size < copySize) {                                                  // 만약 블록의 크기를 줄이는 것이라면 size만큼으로 줄이면 된다.
         copySize = size;
     }
     
+    // 반복해서 커지는 블록은 여유 공간까지 들어가는 free 블록이 있으면 그 곳으로 옮긴다.
+    if (repeated && asize < map_min && (newptr = find_fit(asize + GROW_SLACK(asize))) != NULL) {
+        place(newptr, asize + GROW_SLACK(asize));
+        grow_remember(newptr, asize);
+    }
+    // 그 외에는 mm_malloc처럼 찾는다. 맞는 free 블록이 없으면 힙의 끝에 놓이게 된다.
+    // 큰 블록은 region으로 옮겨지고, 그 뒤로는 위에서 mremap으로 커진다.
+    else if ((newptr = mm_malloc(size)) == NULL) {
+        return NULL;
+    }
+    
+    if (!MAPPED(newptr)) {
+        PUT(HDRP(newptr), GET(HDRP(newptr)) | REALLOC_BIT);                 // 다음에 또 키워지면 반복해서 커지는 블록이다.
+        set_request_size(newptr, asize);
+    }
+    
+    STAT(stats.realloc_copied += copySize);
     memcpy(newptr, oldptr, copySize);                                       // oldptr부터 copySize까지의 데이터를, newptr부터 심겠다.
     mm_free(oldptr);                                                        // 기존 oldptr은 반환한다.
     return newptr;
-}
\ No newline at end of file
+}
+
+/*
+ * grow_in_place - 할당된 블록 bp를 바로 뒤의 free 블록과 합치거나, 힙의 끝이라면 힙을 늘려 asize 이상으로 키운다.
+ *     키울 수 없으면 NULL을 반환한다.
+ */
+static void* grow_in_place(void* bp, size_t asize) {
+    size_t csize = GET_SIZE(HDRP(bp));
+    size_t nsize = 0;                                                       // 바로 뒤의 free 블록의 크기
+    char *next = NEXT_BLKP(bp);
+    char *tail;
+    
+    if (!GET_ALLOC(HDRP(next))) {
+        nsize = GET_SIZE(HDRP(next));
+    }
+    
+    // 합쳐도 모자라다면, 그 뒤가 brk 바로 앞의 epilogue일 때(힙의 끝)만 모자란 만큼 힙을 늘린다.
+    // 늘어난 블록은 extend_heap의 coalesce로 뒤의 free 블록과 합쳐진다. segment의 epilogue 뒤로는 늘릴 수 없다.
+    if (csize + nsize < asize) {
+        tail = (nsize > 0) ? NEXT_BLKP(next) : next;
+        if (GET_SIZE(HDRP(tail)) != 0 || tail != (char*)mem_heap_hi() + 1) {
+            return NULL;
+        }
+        if (extend_heap(MAX(asize - csize - nsize, 2 * DSIZE) / WSIZE) == NULL) {
+            return NULL;
+        }
+        // brk가 가득 차 따로 떨어진 segment가 생겼다면 뒤의 블록은 그대로이므로 키울 수 없다.
+        if (GET_ALLOC(HDRP(next)) || csize + GET_SIZE(HDRP(next)) < asize) {
+            return NULL;
+        }
+        nsize = GET_SIZE(HDRP(next));
+    }
+    
+    removeBlock(next);
+    csize += nsize;
+    
+    // 합친 블록에서 남는 부분은 분할해 free 리스트에 돌려준다. 그 뒤 블록은 할당된 블록이나 epilogue이다.
+    if ((csize - asize) >= split_min) {
+        STAT(stats.splits++);
+        PUT(HDRP(bp), PACK(asize, 1 | REALLOC_BIT));
+        PUT(FTRP(bp), PACK(asize, 1));
+        next = NEXT_BLKP(bp);
+        PUT(HDRP(next), PACK(csize - asize, 0));
+        PUT(FTRP(next), PACK(csize - asize, 0));
+        putFreeBlock(next);
+    } else {
+        PUT(HDRP(bp), PACK(csize, 1 | REALLOC_BIT));
+        PUT(FTRP(bp), PACK(csize, 1));
+        set_request_size(bp, asize);
+    }
+    
+    return bp;
+}
+
+/*
+ * shrink_block - 할당된 블록 bp를 asize로 줄이고, 남는 부분이 충분히 크면 free 블록으로 돌려준다.
+ */
+static void shrink_block(void* bp, size_t asize) {
+    size_t csize = GET_SIZE(HDRP(bp));
+    char *rest;
+    
+    if ((csize - asize) < split_min) {
+        return;
+    }
+    
+    STAT(stats.splits++);
+    PUT(HDRP(bp), PACK(asize, 1 | GET_REALLOC(HDRP(bp))));
+    PUT(FTRP(bp), PACK(asize, 1));
+    rest = NEXT_BLKP(bp);
+    PUT(HDRP(rest), PACK(csize - asize, 0));
+    PUT(FTRP(rest), PACK(csize - asize, 0));
+    coalesce(rest);                                                         // 뒤의 블록이 free 블록일 수 있다.
+}
+
+/*
+ * set_request_size - place처럼, 블록이 요청 크기 asize보다 크다면 요청 크기로 계산한 footer 자리에 실제 크기를 적어둔다.
+ *     (mm_free_sized가 header 대신 읽는다.)
+ */
+static void set_request_size(void* bp, size_t asize) {
+    size_t csize = GET_SIZE(HDRP(bp));
+    
+    if (csize > asize) {
+        PUT((char *)bp + asize - DSIZE, PACK(csize, 1));
+    }
+}
+
+/*
+ * grow_remember - 여유 공간을 받은 블록 bp와 실제로 필요한 크기 asize를 기억한다. 칸이 모자라면 가장 오래된 것을 잊는다.
+ */
+static void grow_remember(void* bp, size_t asize) {
+    if (grow_count == GROW_SLOTS) {
+        memmove(grow_bp, grow_bp + 1, (GROW_SLOTS - 1) * sizeof(grow_bp[0]));
+        memmove(grow_need, grow_need + 1, (GROW_SLOTS - 1) * sizeof(grow_need[0]));
+        grow_count--;
+    }
+    grow_bp[grow_count] = bp;
+    grow_need[grow_count] = asize;
+    grow_count++;
+}
+
+/*
+ * grow_forget - 블록 bp를 기억하고 있었다면 잊는다. 해제되는 블록에 대해 부른다.
+ */
+static void grow_forget(void* bp) {
+    int i;
+    
+    for (i = 0; i < grow_count; i++) {
+        if (grow_bp[i] == bp) {
+            grow_count--;
+            memmove(grow_bp + i, grow_bp + i + 1, (grow_count - i) * sizeof(grow_bp[0]));
+            memmove(grow_need + i, grow_need + i + 1, (grow_count - i) * sizeof(grow_need[0]));
+            return;
+        }
+    }
+}
+
+/*
+ * grow_need_of - 블록 bp를 기억하고 있다면 마지막 realloc에서 실제로 필요했던 크기를, 아니면 블록의 크기를 반환한다.
+ */
+static size_t grow_need_of(void* bp) {
+    int i;
+    
+    for (i = 0; i < grow_count; i++) {
+        if (grow_bp[i] == bp) {
+            return grow_need[i];
+        }
+    }
+    return GET_SIZE(HDRP(bp));
+}
+
+/*
+ * grow_reclaim - 기억하고 있는 블록들의 여유 공간을 잘라 free 리스트에 돌려준다. 돌려준 것이 있으면 1을 반환한다.
+ */
+static int grow_reclaim(void) {
+    int reclaimed = 0;
+    int i;
+    
+    for (i = 0; i < grow_count; i++) {
+        if (GET_SIZE(HDRP(grow_bp[i])) - grow_need[i] >= split_min) {
+            shrink_block(grow_bp[i], grow_need[i]);
+            reclaimed = 1;
+        }
+    }
+    grow_count = 0;
+    
+    return reclaimed;
+}
+
+/*
+ * mm_halloc - size 바이트의 옮길 수 있는 블록을 할당하고 그 핸들을 반환한다. (실패 시 0)
+ *     블록의 주소는 mm_hlock으로 얻는다.
+ */
+mm_handle_t mm_halloc(size_t size) {
+    handle_entry_t *table;
+    unsigned int cap;
+    mm_handle_t h;
+    char *bp;
+    
+    // 빈 칸이 없으면 표를 두 배로 늘리고, 새 칸들을 빈 칸 리스트에 잇는다.
+    if (handle_free == 0) {
+        cap = (handle_cap > 0) ? 2 * handle_cap : HANDLE_INIT;
+        if ((table = mm_realloc(handle_table, cap * sizeof(handle_entry_t))) == NULL) {
+            return 0;
+        }
+        for (h = handle_cap + 1; h <= cap; h++) {
+            table[h - 1].bp = NULL;
+            table[h - 1].pins = (h < cap) ? h + 1 : 0;
+        }
+        handle_free = handle_cap + 1;
+        handle_table = table;
+        handle_cap = cap;
+    }
+    
+    if ((bp = mm_malloc(size + DSIZE)) == NULL) {                           // 핸들 번호를 적을 더블 워드를 더한다.
+        return 0;
+    }
+    h = handle_free;
+    handle_free = handle_table[h - 1].pins;
+    
+    PUT(HDRP(bp), GET(HDRP(bp)) | HANDLE_BIT);
+    PUT(bp, h);
+    handle_table[h - 1].bp = bp;
+    handle_table[h - 1].pins = 0;
+    return h;
+}
+
+/*
+ * mm_hlock - 핸들 h의 블록을 고정하고 payload의 주소를 반환한다. mm_hunlock 전까지 compaction에서 움직이지 않는다.
+ *     할당된 핸들이 아니면 NULL을 반환한다.
+ */
+void *mm_hlock(mm_handle_t h) {
+    if (!HANDLE_VALID(h)) {
+        return NULL;
+    }
+    handle_table[h - 1].pins++;
+    return handle_table[h - 1].bp + DSIZE;
+}
+
+/*
+ * mm_hunlock - mm_hlock으로 고정한 핸들 h의 블록을 한 번 풀어준다. 할당된 핸들이 아니면 아무것도 하지 않는다.
+ */
+void mm_hunlock(mm_handle_t h) {
+    if (HANDLE_VALID(h) && handle_table[h - 1].pins > 0) {
+        handle_table[h - 1].pins--;
+    }
+}
+
+/*
+ * mm_hfree - 핸들 h의 블록을 해제하고 핸들을 돌려준다. 할당된 핸들이 아니면 아무것도 하지 않는다.
+ */
+void mm_hfree(mm_handle_t h) {
+    if (!HANDLE_VALID(h)) {
+        return;
+    }
+    mm_free(handle_table[h - 1].bp);
+    handle_table[h - 1].bp = NULL;
+    handle_table[h - 1].pins = handle_free;
+    handle_free = h;
+}
+
+/*
+ * mm_compact - 고정되지 않은 핸들 블록들을 힙의 앞쪽(mem_heap_lo 쪽)으로 당기고, 힙의 끝에 모인 빈 공간만큼 brk를 낮춘다.
+ *     낮춘 바이트 수를 반환한다. free 리스트는 compaction 뒤의 빈 공간들로 새로 만든다.
+ */
+size_t mm_compact(void) {
+    char *gap;
+    char *end;
+    char *sgap;
+    char *send;
+    size_t released;
+    int i;
+    
+    if (REMOTE_PENDING()) {
+        remote_free_drain();
+    }
+    
+    // 여유 공간을 받은 블록(핸들 테이블일 수도 있다)이 옮겨지면 grow_bp가 옛 주소를 가리키게 되므로, 모두 잊는다.
+    // 여유 공간은 블록에 그대로 남고, grow_reclaim으로 돌려받지 못할 뿐이다.
+    grow_count = 0;
+    
+    // free 블록들은 훑는 동안 덮어쓰이므로, free 리스트를 mm_init 직후처럼 비워둔다.
+    PUT(heap_listp + (2 * WSIZE), 0);
+    PUT(heap_listp + (3 * WSIZE), 0);
+    free_listp = heap_listp + 2 * WSIZE;
+    free_list_end = free_listp;
+    memset(skip_head, 0, sizeof(skip_head));
+    STAT(memset(stats.free_blocks, 0, sizeof(stats.free_blocks)));
+    STAT(stat_free_bytes = 0);
+    
+    gap = compact_run(NEXT_BLKP(heap_listp + 2 * WSIZE), &end);             // prologue 다음의 첫 블록부터
+    
+    // segment는 brk로 줄일 수 없으므로, 끝에 남은 빈 공간은 free 블록으로 둔다.
+    for (i = 0; i < mem_num_segments(); i++) {
+        if ((sgap = compact_run((char*)mem_segment_lo(i) + 4 * WSIZE, &send)) != NULL) {
+            compact_fill(sgap, send - sgap);
+        }
+    }
+    
+    // 힙의 끝에 남은 빈 공간은 brk를 낮춰 돌려준다.
+    if (gap == NULL) {
+        return 0;
+    }
+    released = end - gap;
+    STAT(stats.sbrk_calls++);
+    if (mem_sbrk(-(int)released) == (void*)-1) {                            // brk를 낮추지 못했다면, 빈 공간은 free 블록으로 두고 epilogue도 그대로 둔다.
+        compact_fill(gap, released);
+        return 0;
+    }
+    PUT(HDRP(gap), PACK(0, 1));                                             // 새 epilogue header
+    return released;
+}
+
+/*
+ * compact_run - bp부터 epilogue까지 움직일 수 있는 블록을 앞으로 당긴다.
+ *     움직이지 않는 블록 앞의 빈 공간은 free 블록이 되고, 끝에 남은 빈 공간의 시작을 반환한다 (없으면 NULL).
+ *     *end에는 epilogue의 bp를 담는다.
+ */
+static char* compact_run(char* bp, char** end) {
+    char *gap = NULL;                                                       // 블록을 당겨 올 빈 공간의 시작 (없으면 NULL)
+    size_t size;
+    
+    while ((size = GET_SIZE(HDRP(bp))) > 0) {
+        if (!GET_ALLOC(HDRP(bp))) {
+            if (gap == NULL) {
+                gap = bp;                                                   // 빈 공간이 시작된다.
+            }
+        }
+        else if (gap != NULL && GET_HANDLE(HDRP(bp)) && handle_table[HANDLE_ID(bp) - 1].pins == 0) {
+            // header부터 footer까지 통째로 당긴다. 빈 공간은 당긴 블록의 뒤로 밀려난다.
+            memmove(HDRP(gap), HDRP(bp), size);
+            handle_table[HANDLE_ID(gap) - 1].bp = gap;
+            gap += size;
+        }
+        else if (gap != NULL && bp == (char *)handle_table) {
+            // 핸들 테이블은 handle_table로만 가리키므로 같이 당길 수 있다. 그냥 두면 힙의 끝을 붙잡는다.
+            memmove(HDRP(gap), HDRP(bp), size);
+            handle_table = (handle_entry_t *)gap;
+            gap += size;
+        }
+        else if (gap != NULL) {
+            compact_fill(gap, bp - gap);                                    // 움직이지 않는 블록 앞의 빈 공간은 free 블록이 된다.
+            gap = NULL;
+        }
+        bp += size;
+    }
+    *end = bp;
+    return gap;
+}
+
+/*
+ * compact_fill - compaction이 남긴 gap부터 size 바이트의 빈 공간을 free 블록으로 만들어 free 리스트에 넣는다.
+ *     빈 공간은 앞뒤가 모두 할당된 블록이므로 coalesce할 필요가 없다.
+ */
+static void compact_fill(char* gap, size_t size) {
+    PUT(HDRP(gap), PACK(size, 0));
+    PUT(FTRP(gap), PACK(size, 0));
+    putFreeBlock(gap);
+}
+
+#if MM_STATS
+/*
+ * mm_stats - mm_init 이후의 통계를 out에 담는다. 힙 크기와 free 블록이 아닌 바이트 수는 지금 값이다.
+ */
+void mm_stats(mm_stats_t *out) {
+    *out = stats;
+    out->heap_bytes = mem_heapsize();
+    out->live_bytes = mem_heapsize() - stat_free_bytes;
+}
+
+/*
+ * stat_free_block - size 바이트의 블록이 free 리스트에 들어오면(added) 혹은 나가면, 크기 계급별 수와 free 바이트 수를 고친다.
+ */
+static void stat_free_block(size_t size, int added) {
+    int k = MAX(stat_log2(size) - 4, 0);                                    // 16바이트 이상 32바이트 미만이 0번 계급이다.
+    
+    if (k >= MM_STATS_CLASSES) {
+        k = MM_STATS_CLASSES - 1;
+    }
+    if (added) {
+        stats.free_blocks[k]++;
+        stat_free_bytes += size;
+    } else {
+        stats.free_blocks[k]--;
+        stat_free_bytes -= size;
+    }
+}
+
+/*
+ * stat_search - 끝난 탐색이 살펴본 블록 수(stat_steps)를 히스토그램에 더하고, 다음 탐색을 위해 비운다.
+ */
+static void stat_search(void) {
+    int b = (stat_steps == 0) ? 0 : stat_log2(stat_steps) + 1;              // 0, 1, 2-3, 4-7, ... 개
+    
+    if (b >= MM_STATS_BUCKETS) {
+        b = MM_STATS_BUCKETS - 1;
+    }
+    stats.search_len[b]++;
+    stat_steps = 0;
+}
+
+/*
+ * stat_log2 - 0보다 큰 n의 log2를 내림한 값
+ */
+static int stat_log2(size_t n) {
+    return (int)(8 * sizeof(unsigned long) - 1) - __builtin_clzl(n);
+}
+#endif
\ No newline at end of file
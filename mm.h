@@ -5,6 +5,85 @@ extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
 
+/*
+ * Optional extensions. Not every allocator variant provides these;
+ * the driver checks for each one before using it.
+ */
+
+/* Fit-policy selection and search-length statistics (seglist variant) */
+typedef struct {
+    const char *policy;      /* name of the active fit policy */
+    unsigned long searches;  /* number of find_fit calls */
+    unsigned long steps;     /* free blocks examined over all searches */
+    unsigned long misses;    /* searches that found no fit and grew the heap */
+} fit_stats_t;
+
+extern int mm_set_fit_policy(const char *name, int k);
+extern void mm_get_fit_stats(fit_stats_t *stats);
+
+/* Batched allocation of n equal-sized blocks, and batched free */
+extern size_t mm_malloc_batch(size_t n, size_t size, void **out);
+extern void mm_free_batch(size_t n, void **ptrs);
+
+/* Free a block given the size it was requested with (sized delete) */
+extern void mm_free_sized(void *ptr, size_t size);
+
+/* Set a named tuning parameter (e.g. "chunksize") for the next mm_init */
+extern int mm_set_tunable(const char *name, long value);
+
+/*
+ * Handle-based allocation. A handle block may be moved by mm_compact
+ * unless it is pinned with mm_hlock; its address is only valid while
+ * it is pinned. mm_hlock returns NULL, and mm_hunlock and mm_hfree do
+ * nothing, for a handle that is not allocated. mm_compact returns the
+ * number of bytes by which it lowered the break.
+ */
+typedef unsigned int mm_handle_t;    /* 0 is never a valid handle */
+
+extern mm_handle_t mm_halloc(size_t size);
+extern void *mm_hlock(mm_handle_t h);
+extern void mm_hunlock(mm_handle_t h);
+extern void mm_hfree(mm_handle_t h);
+extern size_t mm_compact(void);
+
+/*
+ * Lifetime hints. A short-lived block is expected to be freed soon, a
+ * long-lived one much later, and a permanent one never. The allocator
+ * may place blocks of different lifetimes apart.
+ */
+typedef enum {
+    MM_HINT_NONE, MM_HINT_SHORT, MM_HINT_LONG, MM_HINT_PERMANENT
+} mm_hint_t;
+
+extern void *mm_malloc_hint(size_t size, mm_hint_t hint);
+
+/*
+ * Allocator statistics since the last mm_init. mm.c, the seglist and
+ * the buddy variants keep them only when built with -DMM_STATS=1 (make
+ * STATS=1); other builds do not define mm_stats and pay nothing for the
+ * counters. Size class k holds
+ * the free blocks of 2^(k+4) up to 2^(k+5) bytes, and search bucket b
+ * the searches that examined 2^(b-1) up to 2^b - 1 free blocks (bucket
+ * 0: none); the last class and bucket also take everything larger.
+ */
+#define MM_STATS_CLASSES 16
+#define MM_STATS_BUCKETS 16
+
+typedef struct mm_stats {
+    unsigned long heap_bytes;     /* bytes from mem_sbrk and segments */
+    unsigned long live_bytes;     /* heap bytes not in free blocks */
+    unsigned long free_blocks[MM_STATS_CLASSES]; /* free blocks by class */
+    unsigned long sbrk_calls;     /* calls to mem_sbrk */
+    unsigned long splits;         /* free blocks split to fit a request */
+    unsigned long coalesce[4];    /* frees with neither neighbor free, */
+                                  /* the next, the previous, or both */
+    unsigned long search_len[MM_STATS_BUCKETS]; /* find_fit calls by */
+                                  /* the number of blocks examined */
+    unsigned long realloc_copied; /* payload bytes copied by mm_realloc */
+} mm_stats_t;
+
+extern void mm_stats(mm_stats_t *stats);
+
 
 /* 
  * Students work in teams of one or two.  Teams enter their team name, 
@@ -0,0 +1,493 @@
+/*
+ * Malloc using binary buddies, with the block state kept in bitmaps outside the blocks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+/*********************************************************
+ * Information of my team
+ ********************************************************/
+team_t team = {
+    /* Team name */
+    "jungle",
+    /* First member's full name */
+    "Shin Seung Jun",
+    /* First member's email address */
+    "alohajune22@gmail.com",
+    /* Second member's full name (leave blank if none) */
+    "",
+    /* Second member's email address (leave blank if none) */
+    ""
+};
+
+/* 기본 상수와 매크로 */
+// 블록의 크기는 항상 2의 거듭제곱(2^k, k를 order라 한다)이고, 힙의 시작(heap_base)으로부터의 offset이 자기 크기의 배수이다.
+// 크기가 2^k인 블록 off의 buddy는 off ^ 2^k이다. 둘이 모두 free이면 합쳐서 크기가 2^(k+1)인 블록이 된다.
+// 블록 안에는 header도 footer도 없다. 블록의 상태는 모두 힙 밖의 bitmap에 있으므로, 요청한 크기를 2의 거듭제곱으로 올린 것이 곧 블록의 크기이다.
+#define MIN_ORDER           4                                               // 가장 작은 블록은 16바이트이다. free 블록에 next/prev 두 포인터가 들어가야 한다.
+#define MAX_ORDER           27                                              // 가장 큰 블록은 128MB이다. (MAX_HEAP보다 크다.)
+#define BLOCK(k)            ((size_t)1 << (k))                              // order k인 블록의 크기
+
+#define MAX(x, y) ((x) > (y) ? (x) : (y))                                   // 최댓값을 구하는 함수 매크로
+#define MIN(x, y) ((x) < (y) ? (x) : (y))                                   // 최솟값을 구하는 함수 매크로
+
+/* free 리스트 */
+// order마다 free 블록들의 이중 연결리스트를 둔다. 넣기, 빼기, 중간에서 떼어내기 모두 O(1)이다.
+#define NEXT_FREE(bp)       (((void**)(bp))[0])
+#define PREV_FREE(bp)       (((void**)(bp))[1])
+
+/* 블록 상태 bitmap */
+// 크기가 2^k인 블록 off마다 bitmap의 비트 하나가 대응된다. 번호는 완전 이진 트리의 중위 순회 순서로 매긴다.
+//     NODE(off, k) = 2 * (off / 16) + 2^(k - 4) - 1
+// 잎(16바이트 블록)은 짝수 번호를, 그 위의 블록들은 그 사이의 홀수 번호를 받는다. 힙의 앞 X바이트 안의 블록들은 모두 2 * X / 16보다 작은 번호를 받으므로,
+// 힙이 자라면 bitmap도 뒤로 자라기만 하면 된다.
+// ALLOC_MAP은 할당된 블록의, FREE_MAP은 free 리스트에 있는 블록의 시작과 order를 표시한다. 둘 다 아닌 번호는 쪼개졌거나 다른 블록 안에 있는 것이다.
+// 그래서 mm_free는 order를 비트 검사만으로 찾고, 합치기는 buddy의 header를 읽는 대신 FREE_MAP의 비트 하나를 검사한다.
+// 두 bitmap은 memlib의 segment에 둔다. segment는 예약 공간의 맨 위에서부터 아래로 붙어서 생기므로, 워드를 위에서부터 거꾸로 쌓으면 한 배열처럼 쓸 수 있다.
+// 두 bitmap의 워드는 번갈아 놓는다. 같은 블록의 두 비트가 같은 캐시 라인에 있게 된다.
+#define ALLOC_MAP           0
+#define FREE_MAP            1
+#define NODE(off, k)        ((((off) >> MIN_ORDER) << 1) + BLOCK((k) - MIN_ORDER) - 1)
+#define MAP_WORD(map, n)    (map_end[-1 - 2 * (long)((n) >> 5) - (map)])
+#define MAP_TEST(map, n)    ((MAP_WORD(map, n) >> ((n) & 31)) & 1)
+#define MAP_SET(map, n)     (MAP_WORD(map, n) |= 1u << ((n) & 31))
+#define MAP_CLEAR(map, n)   (MAP_WORD(map, n) &= ~(1u << ((n) & 31)))
+
+/* region 블록 */
+// 요청한 크기가 MAP_THRESHOLD 이상이면 버디 힙 대신 memlib가 따로 매핑해 주는 region 하나에 둔다. (mm.c의 map_block과 같다.)
+// 2의 거듭제곱으로 올리면 거의 절반까지 버려지지만, region은 페이지 단위로만 올리므로 큰 블록에서는 버려지는 바이트가 한 페이지를 넘지 않는다.
+// region의 블록은 힙 밖에 있으므로 heap_base로부터의 offset이 heap_top 이상이 된다. bitmap에는 없고, 대신 payload 앞의 MAP_HDR바이트에 region의 크기를 둔다.
+#define MAP_THRESHOLD       (1<<13)                                         // 8kB
+#define MAP_HDR             8                                               // region의 크기를 담는 자리. payload의 정렬을 8바이트로 유지한다.
+#define MAPPED(bp)          ((size_t)((char*)(bp) - heap_base) >= heap_top) // bp가 region의 블록인지
+#define MAP_LEN(bp)         (*(size_t*)((char*)(bp) - MAP_HDR))             // bp가 있는 region의 크기
+
+/* 통계 (mm_stats) */
+// 컴파일 시 -DMM_STATS=1 (make STATS=1) 로 켜면 mm.c와 같은 mm_stats가 생긴다.
+// buddy에는 앞뒤 이웃 대신 buddy 하나가 있으므로, coalesce는 처음 합친 buddy가 뒤쪽(next)인지 앞쪽(prev)인지로 센다.
+// 탐색 길이는 free 블록이 있는 order를 찾을 때까지 들여다본 free 리스트의 수이다.
+#ifndef MM_STATS
+#define MM_STATS            0
+#endif
+#if MM_STATS
+#define STAT(stmt)          do { stmt; } while (0)
+#else
+#define STAT(stmt)          do { } while (0)
+#endif
+
+/*
+ * global variable & functions
+ */
+static char* heap_base;                                                     // 모든 offset의 기준인 힙의 시작
+static size_t heap_top;                                                     // 힙의 끝의 offset. 이 뒤에 걸친 블록은 없다.
+static void* free_lists[MAX_ORDER + 1];                                     // order마다 free 블록들의 연결리스트
+static unsigned int* map_end;                                               // bitmap의 맨 위 (첫 워드는 map_end[-1]이다.)
+static size_t map_nodes;                                                    // bitmap이 담을 수 있는 번호의 수
+#if MM_STATS
+static mm_stats_t stats;                                                    // mm_init 이후의 통계. heap_bytes와 live_bytes는 mm_stats에서 채운다.
+static size_t stat_free_bytes;                                              // free 리스트에 있는 블록들의 크기 합
+#endif
+
+static int order_of(size_t size);
+static int block_order(size_t off);
+static void push_free(size_t off, int k);
+static void unlink_free(size_t off, int k);
+static void release(size_t off, int k);
+static int extend_heap(int k);
+static int map_reserve(size_t top);
+static void* map_block(size_t size);
+static void* map_resize(void* bp, size_t size);
+#if MM_STATS
+static int stat_buddy_side(size_t off, int k);
+static void stat_search(int steps);
+static int stat_log2(size_t n);
+#endif
+
+/*
+ * mm_init - initialize the malloc package.
+ */
+int mm_init(void) {
+    int k;
+    
+    for (k = 0; k <= MAX_ORDER; k++) {
+        free_lists[k] = NULL;
+    }
+    STAT(memset(&stats, 0, sizeof(stats)));
+    STAT(stat_free_bytes = 0);
+    STAT(stats.sbrk_calls = 1);                                             // 아래의 mem_sbrk
+    
+    // 힙은 처음에 비어 있다. bitmap은 힙이 처음 자랄 때 segment로 받는다.
+    if ((heap_base = mem_sbrk(0)) == (void*)-1) {
+        return -1;
+    }
+    heap_top = 0;
+    map_end = NULL;
+    map_nodes = 0;
+    return 0;
+}
+
+/*
+ * mm_malloc - 요청한 크기 이상인 가장 작은 order의 블록을 할당한다.
+ *     그 order의 free 블록이 없으면 더 큰 블록을 꺼내 반씩 쪼개고, 쓰지 않는 뒤쪽 절반들은 free 리스트에 넣는다.
+ */
+void *mm_malloc(size_t size) {
+    char *bp;
+    size_t off;
+    int k, j;
+    
+    if (size == 0) {
+        return NULL;                                                        // 가짜 요청은 무시한다.
+    }
+    if (size >= MAP_THRESHOLD && (bp = map_block(size)) != NULL) {
+        return bp;                                                          // region을 받지 못하면 힙에서 할당한다.
+    }
+    if ((k = order_of(size)) > MAX_ORDER) {
+        return NULL;
+    }
+    
+    // k 이상의 order 중 free 블록이 있는 가장 작은 order를 찾는다. 없으면 힙을 늘리고 다시 찾는다.
+    for (j = k; j <= MAX_ORDER && free_lists[j] == NULL; j++)
+        ;
+    STAT(stat_search(MIN(j, MAX_ORDER) - k + 1));                           // 힙을 늘려야 한다면 모든 free 리스트를 들여다본 셈이다.
+    if (j > MAX_ORDER) {
+        if (extend_heap(k) < 0) {
+            return NULL;
+        }
+        for (j = k; free_lists[j] == NULL; j++)
+            ;
+    }
+    
+    off = (char*)free_lists[j] - heap_base;
+    unlink_free(off, j);
+    
+    // 블록을 반씩 쪼개, 뒤쪽 절반은 free 리스트에 넣고 앞쪽 절반을 계속 쪼갠다.
+    while (j > k) {
+        j--;
+        push_free(off + BLOCK(j), j);
+        STAT(stats.splits++);
+    }
+    
+    MAP_SET(ALLOC_MAP, NODE(off, k));
+    return heap_base + off;
+}
+
+/*
+ * mm_free - 블록을 free시키고, buddy가 free인 동안 계속 합친다. 합치는 횟수는 order의 수를 넘지 않는다.
+ */
+void mm_free(void *bp) {
+    size_t off;
+    int k;
+    
+    if (bp == NULL) {
+        return;
+    }
+    if (MAPPED(bp)) {
+        mem_unmap_region((char*)bp - MAP_HDR);                              // region은 통째로 돌려준다.
+        return;
+    }
+    
+    off = (char*)bp - heap_base;
+    k = block_order(off);
+    MAP_CLEAR(ALLOC_MAP, NODE(off, k));
+    STAT(stats.coalesce[stat_buddy_side(off, k)]++);
+    release(off, k);
+}
+
+/*
+ * mm_realloc - 블록의 order 안에서 끝나면 그대로 둔다. 줄일 때는 쓰지 않는 뒤쪽 절반들을 돌려준다.
+ *     키울 때는 블록이 더 큰 order의 앞쪽이고 그 뒤의 buddy들이 모두 free이면, 그들을 합쳐 제자리에서 키운다.
+ *     그 외에는 새 블록으로 옮긴다. region의 블록은 region째로 늘리거나 줄인다.
+ */
+void *mm_realloc(void *ptr, size_t size) {
+    void *newptr;                                                           // 크기 조절 뒤의 새 블록
+    size_t off;
+    size_t copySize;                                                        // 복사할 payload의 크기
+    int k, need, j;
+    
+    if (ptr == NULL) {
+        return mm_malloc(size);
+    }
+    if (size == 0) {
+        mm_free(ptr);
+        return NULL;
+    }
+    
+    // region의 블록은 mremap으로 늘리거나 줄인다. 늘릴 수 없으면 아래에서 힙의 블록으로 옮긴다.
+    if (MAPPED(ptr)) {
+        if ((newptr = map_resize(ptr, size)) != NULL) {
+            return newptr;
+        }
+        if ((newptr = mm_malloc(size)) == NULL) {
+            return NULL;
+        }
+        copySize = MIN(MAP_LEN(ptr) - MAP_HDR, size);
+        memcpy(newptr, ptr, copySize);
+        STAT(stats.realloc_copied += copySize);
+        mm_free(ptr);
+        return newptr;
+    }
+    
+    off = (char*)ptr - heap_base;
+    k = block_order(off);
+    need = order_of(size);
+    
+    // 줄이는 경우. 뒤쪽 절반들의 buddy(앞쪽 절반)는 할당된 채이므로 돌려주는 블록이 다시 합쳐지지는 않는다.
+    if (need <= k) {
+        if (need < k) {
+            MAP_CLEAR(ALLOC_MAP, NODE(off, k));
+            while (k > need) {
+                k--;
+                push_free(off + BLOCK(k), k);
+                STAT(stats.splits++);
+            }
+            MAP_SET(ALLOC_MAP, NODE(off, need));
+        }
+        return ptr;
+    }
+    
+    // region에 둘 크기로 키우는 경우는 아래에서 새 region으로 옮긴다.
+    if (size >= MAP_THRESHOLD) {
+        need = MAX_ORDER + 1;
+    }
+    
+    // 제자리에서 키우는 경우. off가 order need인 블록의 시작이고, order k, k+1, ..., need-1의 뒤쪽 buddy들이 모두 free여야 한다.
+    if (need <= MAX_ORDER && (off & (BLOCK(need) - 1)) == 0 && off + BLOCK(need) <= heap_top) {
+        for (j = k; j < need && MAP_TEST(FREE_MAP, NODE(off + BLOCK(j), j)); j++)
+            ;
+        if (j == need) {
+            for (j = k; j < need; j++) {
+                unlink_free(off + BLOCK(j), j);
+            }
+            MAP_CLEAR(ALLOC_MAP, NODE(off, k));
+            MAP_SET(ALLOC_MAP, NODE(off, need));
+            return ptr;
+        }
+    }
+    
+    if ((newptr = mm_malloc(size)) == NULL) {
+        return NULL;
+    }
+    copySize = BLOCK(k);
+    if (size < copySize) {
+        copySize = size;
+    }
+    memcpy(newptr, ptr, copySize);
+    STAT(stats.realloc_copied += copySize);
+    mm_free(ptr);
+    return newptr;
+}
+
+/*
+ * order_of - size 바이트가 들어가는 가장 작은 블록의 order를 반환한다.
+ */
+static int order_of(size_t size) {
+    int k = MIN_ORDER;
+    
+    while (k <= MAX_ORDER && BLOCK(k) < size) {
+        k++;
+    }
+    return k;
+}
+
+/*
+ * block_order - offset off에서 시작하는 할당된 블록의 order를 ALLOC_MAP에서 찾는다.
+ *     off에서 시작할 수 있는 order는 off를 나누는 2의 거듭제곱들뿐이므로, 작은 order부터 많아야 order의 수만큼 검사한다.
+ */
+static int block_order(size_t off) {
+    int k = MIN_ORDER;
+    
+    while (!MAP_TEST(ALLOC_MAP, NODE(off, k))) {
+        k++;
+    }
+    return k;
+}
+
+/*
+ * push_free - order k인 블록 off를 free 리스트의 맨 앞에 넣고 FREE_MAP에 표시한다.
+ */
+static void push_free(size_t off, int k) {
+    char *bp = heap_base + off;
+    
+    NEXT_FREE(bp) = free_lists[k];
+    PREV_FREE(bp) = NULL;
+    if (free_lists[k] != NULL) {
+        PREV_FREE(free_lists[k]) = bp;
+    }
+    free_lists[k] = bp;
+    MAP_SET(FREE_MAP, NODE(off, k));
+    STAT(stats.free_blocks[MIN(k - MIN_ORDER, MM_STATS_CLASSES - 1)]++);
+    STAT(stat_free_bytes += BLOCK(k));
+}
+
+/*
+ * unlink_free - order k인 free 블록 off를 free 리스트에서 떼어내고 FREE_MAP에서 지운다.
+ */
+static void unlink_free(size_t off, int k) {
+    char *bp = heap_base + off;
+    
+    if (PREV_FREE(bp) != NULL) {
+        NEXT_FREE(PREV_FREE(bp)) = NEXT_FREE(bp);
+    } else {
+        free_lists[k] = NEXT_FREE(bp);
+    }
+    if (NEXT_FREE(bp) != NULL) {
+        PREV_FREE(NEXT_FREE(bp)) = PREV_FREE(bp);
+    }
+    MAP_CLEAR(FREE_MAP, NODE(off, k));
+    STAT(stats.free_blocks[MIN(k - MIN_ORDER, MM_STATS_CLASSES - 1)]--);
+    STAT(stat_free_bytes -= BLOCK(k));
+}
+
+/*
+ * release - order k인 블록 off를 buddy들과 합쳐 free 리스트에 넣는다.
+ *     buddy가 힙의 끝을 넘으면 bitmap에 없는 번호이므로 검사하지 않는다.
+ */
+static void release(size_t off, int k) {
+    size_t buddy;
+    
+    while (k < MAX_ORDER) {
+        buddy = off ^ BLOCK(k);
+        if (buddy + BLOCK(k) > heap_top || !MAP_TEST(FREE_MAP, NODE(buddy, k))) {
+            break;
+        }
+        unlink_free(buddy, k);
+        off &= ~BLOCK(k);                                                   // 합친 블록은 둘 중 앞쪽에서 시작한다.
+        k++;
+    }
+    push_free(off, k);
+}
+
+/*
+ * extend_heap - order k인 블록이 하나 들어가도록 힙을 늘린다. 힙의 끝을 2^k의 배수로 맞추는 데에 드는 앞부분은
+ *     맞춰 넣을 수 있는 가장 큰 블록들로 나누어 free시킨다. 모두 free 리스트에 들어가 다음 할당에 쓰인다.
+ *     실패하면 -1을 반환한다.
+ */
+static int extend_heap(int k) {
+    size_t off = heap_top;
+    size_t top = ((heap_top + BLOCK(k) - 1) & ~(BLOCK(k) - 1)) + BLOCK(k);
+    int j;
+    
+    if (map_reserve(top) < 0 || mem_sbrk(top - heap_top) == (void*)-1) {
+        return -1;
+    }
+    STAT(stats.sbrk_calls++);
+    heap_top = top;
+    
+    while (off < top) {
+        for (j = MAX_ORDER; (off & (BLOCK(j) - 1)) != 0 || off + BLOCK(j) > top; j--)
+            ;
+        release(off, j);
+        off += BLOCK(j);
+    }
+    return 0;
+}
+
+/*
+ * map_reserve - 힙의 끝이 top까지 자라도 bitmap이 모자라지 않게 늘린다. 새 워드는 0으로 채운다.
+ *     segment를 받을 때마다 두 배 이상으로 늘려, segment의 수가 적게 유지되게 한다. 실패하면 -1을 반환한다.
+ */
+static int map_reserve(size_t top) {
+    size_t nodes = 2 * (top >> MIN_ORDER);                                  // 힙의 앞 top바이트 안의 블록들이 받는 번호의 수
+    size_t size;
+    char *seg;
+    
+    if (nodes <= map_nodes) {
+        return 0;
+    }
+    
+    // 번호 32개가 두 bitmap의 워드 두 개, 즉 8바이트를 차지한다.
+    size = (MAX(nodes - map_nodes, map_nodes) + 31) / 32 * 2 * sizeof(unsigned int);
+    size = (size + mem_pagesize() - 1) & ~(mem_pagesize() - 1);
+    if ((seg = mem_segment(size)) == NULL) {
+        return -1;
+    }
+    if (map_end == NULL) {
+        map_end = (unsigned int*)(seg + size);
+    }
+    assert((char*)map_end - 2 * sizeof(unsigned int) * (map_nodes / 32) == seg + size);  // 새 segment는 bitmap 바로 아래에 붙어 있다.
+    memset(seg, 0, size);
+    map_nodes += size / (2 * sizeof(unsigned int)) * 32;
+    return 0;
+}
+
+/*
+ * map_block - payload가 size 바이트인 블록을 새 region에 만들어 반환한다. region을 받지 못하면 NULL을 반환한다.
+ */
+static void* map_block(size_t size) {
+    size_t len = (size + MAP_HDR + mem_pagesize() - 1) & ~(mem_pagesize() - 1);  // header를 더해 페이지 단위로 올린다.
+    char* map;
+    
+    if ((map = mem_map_region(len)) == NULL) {
+        return NULL;
+    }
+    *(size_t*)map = len;                                                    // MAP_LEN이 읽는 자리
+    return map + MAP_HDR;
+}
+
+/*
+ * map_resize - region의 블록 bp를 payload가 size 바이트가 되도록 mremap으로 늘리거나 줄이고, 옮겨진 bp를 반환한다.
+ *     페이지 수가 그대로면 아무 일도 하지 않는다. region을 늘릴 수 없으면 NULL을 반환하고, 블록은 그대로 남는다.
+ */
+static void* map_resize(void* bp, size_t size) {
+    size_t len = (size + MAP_HDR + mem_pagesize() - 1) & ~(mem_pagesize() - 1);
+    char* map;
+    
+    if (len == MAP_LEN(bp)) {
+        return bp;
+    }
+    if ((map = mem_remap_region((char*)bp - MAP_HDR, len)) == NULL) {
+        return NULL;
+    }
+    *(size_t*)map = len;
+    return map + MAP_HDR;
+}
+
+#if MM_STATS
+/*
+ * mm_stats - mm_init 이후의 통계를 out에 담는다. 힙 크기와 free 블록이 아닌 바이트 수는 지금 값이다.
+ */
+void mm_stats(mm_stats_t *out) {
+    *out = stats;
+    out->heap_bytes = mem_heapsize();
+    out->live_bytes = mem_heapsize() - stat_free_bytes;
+}
+
+/*
+ * stat_buddy_side - free되는 order k인 블록 off가 처음 합칠 buddy의 자리를 coalesce의 칸 번호로 반환한다.
+ *     buddy가 free가 아니면 0, 뒤쪽이면 1, 앞쪽이면 2이다.
+ */
+static int stat_buddy_side(size_t off, int k) {
+    size_t buddy = off ^ BLOCK(k);
+    
+    if (k >= MAX_ORDER || buddy + BLOCK(k) > heap_top || !MAP_TEST(FREE_MAP, NODE(buddy, k))) {
+        return 0;
+    }
+    return (buddy > off) ? 1 : 2;
+}
+
+/*
+ * stat_search - 들여다본 free 리스트의 수 steps를 탐색 길이 히스토그램에 더한다.
+ */
+static void stat_search(int steps) {
+    int b = stat_log2(steps) + 1;                                           // 1, 2-3, 4-7, ... 개
+    
+    if (b >= MM_STATS_BUCKETS) {
+        b = MM_STATS_BUCKETS - 1;
+    }
+    stats.search_len[b]++;
+}
+
+/*
+ * stat_log2 - 0보다 큰 n의 log2를 내림한 값
+ */
+static int stat_log2(size_t n) {
+    return (int)(8 * sizeof(unsigned long) - 1) - __builtin_clzl(n);
+}
+#endif
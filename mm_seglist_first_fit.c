@@ -1,5 +1,5 @@
 /*
- * Malloc using segregated free list with first-fit
+ * Malloc using segregated free lists kept in size order by skip lists, with a pluggable fit policy
  */
 
 #include <stdio.h>
@@ -10,6 +10,7 @@
 
 #include "mm.h"
 #include "memlib.h"
+#include "size_classes.h"
 
 /*********************************************************
  * Information of my team
@@ -49,7 +50,7 @@ team_t team = {
 #define WSIZE       4                                                       // 워드 사이즈
 #define DSIZE       8                                                       // 더블 워드 사이즈
 #define CHUNKSIZE   (1<<12)                                                 // 처음 4kB 할당. 초기 free 블록이다.
-#define LISTLIMIT   20
+#define LISTLIMIT   SIZE_CLASSES                                            // 크기 범위(size class)는 traces/sizeclasses.pl이 트레이스에서 뽑아 size_classes.h로 만든다.
 
 #define MAX(x, y) ((x) > (y) ? (x) : (y))                                   // 최댓값을 구하는 함수 매크로
 
@@ -81,11 +82,78 @@ team_t team = {
 #define PRED_FREE(bp)      (*(void**)(bp))         
 #define SUCC_FREE(bp)      (*(void**)(bp + WSIZE))
 
+/* fit 정책 */
+// 각 정책은 find_fit이 연결리스트 안에서 어떤 블록을 고를지를 정한다.
+// mm_set_fit_policy로 고르거나, 환경변수 MM_FIT_POLICY(first, next, best, good, exact)와 MM_FIT_K로 고를 수 있다. mm_init 때 적용된다.
+#define FIT_FIRST   0                                                       // 처음 만나는 맞는 블록
+#define FIT_NEXT    1                                                       // 연결리스트마다 rover를 두고, 지난번에 멈춘 곳부터 탐색하는 next-fit
+#define FIT_BEST    2                                                       // 연결리스트 전체에서 가장 작은 맞는 블록
+#define FIT_GOOD    3                                                       // 맞는 블록 K개 중 가장 작은 블록 (bounded best-fit)
+#define FIT_EXACT   4                                                       // 분할이 필요 없는 블록을 먼저 찾고, 없으면 first-fit
+#define FIT_DEFAULT_K   8                                                   // FIT_GOOD에서 K의 기본값
+
+/* 연결리스트 안의 정렬 방식 */
+// SIZE_ORDER는 각 연결리스트를 (크기, 주소) 오름차순으로 유지한다. 연결리스트마다 free 블록 안에 skip list를 만들어
+// 삽입, 제거, lower-bound 탐색을 O(log n)으로 만든다. 이 때 find_fit은 lower-bound 탐색으로 연결리스트 안의 best-fit을 찾는다.
+// LIFO_ORDER는 연결리스트의 맨 앞에 넣기만 한다. 이 때는 fit 정책마다 연결리스트를 선형으로 탐색한다.
+// 컴파일 시 -DCLASS_ORDER=LIFO_ORDER 처럼 선택할 수 있다.
+#define LIFO_ORDER      0
+#define SIZE_ORDER      1
+#ifndef CLASS_ORDER
+#define CLASS_ORDER     SIZE_ORDER
+#endif
+
+/* 통계 (mm_stats) */
+// 컴파일 시 -DMM_STATS=1 (make STATS=1) 로 켜면 mm.c와 같은 mm_stats가 생긴다. 탐색 길이는 fit_stats.steps로 센 블록 수를 쓴다.
+// 끄면 STAT(...)은 아무 코드도 남기지 않으므로, 기본 빌드의 속도에는 영향이 없다.
+#ifndef MM_STATS
+#define MM_STATS            0
+#endif
+#if MM_STATS
+#define STAT(stmt)          do { stmt; } while (0)
+#else
+#define STAT(stmt)          do { } while (0)
+#endif
+
+/* skip list 관련 상수와 매크로 */
+// free 블록의 구조 : | header | pred | succ | level | fwd[1] | fwd[2] | ... | footer |
+// 0층은 기존의 pred/succ 이중 연결리스트 그대로이고, 1층 이상은 fwd[k]로만 이어지는 단일 연결리스트이다.
+// 최소 블록(16바이트)은 level 워드를 담을 자리가 없으므로 항상 0층에만 들어간다.
+// 최소 블록은 가장 작아 항상 연결리스트의 맨 앞에 모이므로, 주소 대신 넣은 순서로 두고 맨 앞에 O(1)로 넣는다.
+// 그 마지막 블록을 min_tail에 기억해, 더 큰 블록의 0층 탐색이 최소 블록들을 하나씩 건너지 않게 한다.
+#define MINBLOCK            (2 * DSIZE)                                     // header/footer/pred/succ가 들어가는 최소 블록 크기
+#define SKIP_MAXLEVEL       16                                              // skip list의 최대 층 수
+#define SKIP_LEVEL(bp)      (GET((char *)(bp) + (2 * WSIZE)))               // 블록이 속한 층의 수(높이)
+#define SKIP_FWD(bp, k)     (*(void**)((char *)(bp) + ((2 + (k)) * WSIZE))) // k층(k >= 1)에서의 다음 블록
+#define SKIP_CAPACITY(size) (((size) / WSIZE) - 4)                          // 블록 크기가 허용하는 최대 높이
+
 /* 
  * global variable & functions
  */
 static void* heap_listp;
 static void* segregation_list[LISTLIMIT];
+static void* rover[LISTLIMIT];                                              // FIT_NEXT에서 연결리스트마다 다음 탐색을 시작할 블록
+static void* skip_head[LISTLIMIT][SKIP_MAXLEVEL];                           // 연결리스트마다 1층 이상의 맨 첫 블록. 0층의 맨 첫 블록은 segregation_list이다.
+static void* min_tail[LISTLIMIT];                                           // 연결리스트 맨 앞에 모인 최소 블록들 중 마지막 블록 (없으면 NULL)
+static unsigned int skip_seed;                                              // 블록의 높이를 정하는 난수 발생기의 상태
+
+static const char* fit_names[] = {"first", "next", "best", "good", "exact"};
+static int fit_policy = FIT_FIRST;                                          // mm_init 때 정해지는 현재 fit 정책
+static int fit_k = FIT_DEFAULT_K;
+static int fit_requested = -1;                                              // mm_set_fit_policy로 요청된 정책. -1이면 환경변수를 따른다.
+static int fit_requested_k = FIT_DEFAULT_K;
+static fit_stats_t fit_stats;                                               // find_fit의 탐색 길이 통계
+static size_t chunksize = CHUNKSIZE;                                        // 힙을 늘릴 때의 최소 크기. mm_set_tunable로 바꿀 수 있다.
+static size_t split_min = 2 * DSIZE;                                        // 분할하고 남은 블록의 최소 크기. 이보다 작게 남으면 분할하지 않는다.
+static int list_limit = LISTLIMIT;                                          // 실제로 쓰는 연결리스트의 수. 이를 넘는 크기 범위는 마지막 연결리스트에 합쳐진다.
+static size_t pending_chunksize = CHUNKSIZE;                                // mm_set_tunable로 정한 값들. 다음 mm_init에서 위의 변수들로 옮겨진다.
+static size_t pending_split_min = 2 * DSIZE;
+static int pending_list_limit = LISTLIMIT;
+#if MM_STATS
+static mm_stats_t stats;                                                    // mm_init 이후의 통계. heap_bytes와 live_bytes는 mm_stats에서 채운다.
+static size_t stat_free_bytes;                                              // 연결리스트에 있는 블록들의 크기 합
+static unsigned long stat_steps;                                            // 지난 탐색이 끝났을 때의 fit_stats.steps
+#endif
 
 static void* extend_heap(size_t words);
 static void* coalesce(void *bp);
@@ -93,6 +161,24 @@ static void* find_fit(size_t asize);
 static void place(void* bp, size_t asize);
 static void remove_block(void *bp);
 static void insert_block(void *bp, size_t size);
+static int parse_fit_policy(const char *name);
+static void *fit_first(int list, size_t asize);
+static void *fit_next(int list, size_t asize);
+static void *fit_best(int list, size_t asize, int limit);
+static void *fit_exact(int list, size_t asize);
+static void *fit_lower_bound(int list, size_t asize);
+static int list_index(size_t size);
+static int skip_less(void *a, size_t asize, void *b);
+static int skip_height(void *bp);
+static int skip_random_level(size_t size);
+static void *skip_next(int list, void *x, int k);
+static void skip_set_next(int list, void *x, int k, void *next);
+static void *skip_find_prev(int list, void *bp, void **update, int height);
+#if MM_STATS
+static void stat_free_block(size_t size, int added);
+static void stat_search(void);
+static int stat_log2(size_t n);
+#endif
 
 /*
  * mm_init - initialize the malloc package.
@@ -100,10 +186,41 @@ static void insert_block(void *bp, size_t size);
 int mm_init(void) {
     int list;
     
+    // mm_set_tunable로 정한 값들은 이제부터 적용된다. 연결리스트의 수가 바뀌면 이미 있는 free 블록을 찾을 수 없게 되기 때문이다.
+    chunksize = pending_chunksize;
+    split_min = pending_split_min;
+    list_limit = pending_list_limit;
+    
     // seglist의 포인터 모두 NULL로 초기화시킨다.
     for (list = 0; list < LISTLIMIT; list++) {
         segregation_list[list] = NULL;
+        rover[list] = NULL;
+        min_tail[list] = NULL;
     }
+    memset(skip_head, 0, sizeof(skip_head));
+    skip_seed = 2463534242u;                                                // 매 실행마다 같은 결과가 나오도록 난수 상태도 초기화한다.
+    
+    // fit 정책을 정한다. mm_set_fit_policy로 요청된 정책이 우선이고, 없으면 환경변수를 따른다.
+    if (fit_requested >= 0) {
+        fit_policy = fit_requested;
+        fit_k = fit_requested_k;
+    } else {
+        fit_policy = parse_fit_policy(getenv("MM_FIT_POLICY"));
+        fit_k = (getenv("MM_FIT_K") != NULL) ? atoi(getenv("MM_FIT_K")) : FIT_DEFAULT_K;
+        if (fit_policy < 0) {
+            fit_policy = FIT_FIRST;
+        }
+    }
+    if (fit_k < 1) {
+        fit_k = 1;
+    }
+    
+    memset(&fit_stats, 0, sizeof(fit_stats));
+    fit_stats.policy = fit_names[fit_policy];
+    STAT(memset(&stats, 0, sizeof(stats)));
+    STAT(stat_free_bytes = 0);
+    STAT(stat_steps = 0);
+    STAT(stats.sbrk_calls = 1);                                             // 아래의 mem_sbrk
     
     if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)                   // memlib.c를 살펴보면 할당 실패시 (void *)-1을 반환하고 있다. 정상 포인터를 반환하는 것과는 달리, 오류 시 이와 구분 짓기 위해 mem_sbrk는 (void *)-1을 반환하고 있다.
         return -1;                                                          // 할당에 실패하면 -1을 리턴한다.
@@ -116,7 +233,7 @@ int mm_init(void) {
     heap_listp += (2 * WSIZE);                                              // heap_listp는 prologue footer를 가르키도록 만든다.
     
     // CHUCKSIZE만큼 힙을 확장해 초기 free 블록을 생성한다. 이 때 CHUCKSIZE는 2^12으로 4kB 정도였다.(4096 bytes)
-    if (extend_heap(CHUNKSIZE / WSIZE) == NULL) {                           // 곧바로 extend_heap이 실행된다.
+    if (extend_heap(chunksize / WSIZE) == NULL) {                           // 곧바로 extend_heap이 실행된다.
         return -1;
     }
     
@@ -146,7 +263,7 @@ void *mm_malloc(size_t size) {
     }
     
     // 적절한 공간을 찾지 못했다면 힙을 늘려주고, 그 늘어난 공간에 할당시켜야 한다.
-    extendsize = MAX(asize, CHUNKSIZE);                                     // 둘 중 더 큰 값을 선택한다.
+    extendsize = MAX(asize, chunksize);                                     // 둘 중 더 큰 값을 선택한다.
     if ((bp = extend_heap(extendsize / WSIZE)) == NULL) {                   // 실패 시 bp로는 NULL을 반환한다.
         return NULL;
     }
@@ -193,6 +310,7 @@ void *mm_realloc(void *ptr, size_t size) {
     }
     
     memcpy(newptr, oldptr, copySize);                                       // oldptr부터 copySize까지의 데이터를, newptr부터 심겠다.
+    STAT(stats.realloc_copied += copySize);
     mm_free(oldptr);                                                        // 기존 oldptr은 반환한다.
     return newptr;
 }
@@ -210,6 +328,7 @@ static void* extend_heap(size_t words) {
     if ((long)(bp = mem_sbrk(size)) == -1) {                                // 변환한 사이즈만큼 메모리 확보에 실패하면 NULL이라는 주소값을 반환해 실패했음을 알린다. bp 자체의 값, 즉 주소값이 32bit이므로 long으로 캐스팅한다.
         return NULL;                                                        // 그리고 mem_sbrk 함수가 실행되므로 bp는 새로운 메모리의 첫 주소값을 가르키게 된다.
     }              
+    STAT(stats.sbrk_calls++);
     
     // 새 free 블록의 header와 footer를 정해준다. 자연스럽게 전 epilogue 자리에는 새로운 header가 자리 잡게 된다. 그리고 epilogue는 맨 뒤로 보내지게 된다.
     PUT(HDRP(bp), PACK(size, 0));                                           // 새 free 블록의 header로, free 이므로 0을 부여
@@ -230,11 +349,13 @@ static void *coalesce(void *bp) {
     // 경우 1. 이전 블록 할당, 다음 블록 할당 - 연결시킬 수 없으니 그대로 bp를 반환한다.
     // 해당 블록을 seglist에서 적절한 연결리스트를 찾아 넣는다.    
     if (prev_alloc && next_alloc) {
+        STAT(stats.coalesce[0]++);
         insert_block(bp, size);
         return bp;
     }
     
     else if (prev_alloc && !next_alloc) {
+        STAT(stats.coalesce[1]++);
         remove_block(NEXT_BLKP(bp));                                        // free 상태였던 다음 블록을 free 리스트에서 제거한다.
         size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
         PUT(HDRP(bp), PACK(size, 0));
@@ -242,6 +363,7 @@ static void *coalesce(void *bp) {
     }
     
     else if (!prev_alloc && next_alloc) {
+        STAT(stats.coalesce[2]++);
         remove_block(PREV_BLKP(bp));                                        // free 상태였던 이전 블록을 free 리스트에서 제거한다.
         size += GET_SIZE(HDRP(PREV_BLKP(bp)));
         PUT(FTRP(bp), PACK(size , 0));
@@ -250,6 +372,7 @@ static void *coalesce(void *bp) {
     }
     
     else if (!prev_alloc && !next_alloc) {
+        STAT(stats.coalesce[3]++);
         remove_block(PREV_BLKP(bp));                                        // free 상태였던 이전 블록을 free 리스트에서 제거한다.
         remove_block(NEXT_BLKP(bp));                                        // free 상태였던 다음 블록을 free 리스트에서 제거한다.
         size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
@@ -275,7 +398,8 @@ static void place(void *bp, size_t asize) {
     // 분할이 가능한 경우
     // 할당하고 남은 메모리가 free 블록을 만들 수 있는 4개의 word가 되느냐
     // header/footer/prec/next가 필요하니 최소 4개의 word는 필요하다.
-    if ((csize - asize) >= (2 * DSIZE)) {
+    if ((csize - asize) >= split_min) {
+        STAT(stats.splits++);
         // 앞의 블록은 할당시킨다.
         PUT(HDRP(bp), PACK(asize, 1));
         PUT(FTRP(bp), PACK(asize, 1));
@@ -296,47 +420,298 @@ static void place(void *bp, size_t asize) {
 }
 
 /*
- * find_fit - first-fit, 해당 블록의 사이즈가 속할 수 있는 사이즈 범위를 가진 연결리스트를 탐색하고, 그 연결리스트 내에서 적절한 블록을 또 탐색한다.
+ * find_fit - 해당 블록의 사이즈가 속할 수 있는 사이즈 범위를 가진 연결리스트를 탐색하고, 그 연결리스트 내에서 fit 정책에 따라 적절한 블록을 또 탐색한다.
  */
 static void *find_fit(size_t asize) {
     void* bp;
     
-    int list = 0;
-    size_t searchsize = asize;
+    int list;
     
-    while (list < LISTLIMIT) {
-        // bp가 19번째(0부터 시작했으니 19번째는 마지막 연결리스트이다) 연결리스트에 도달하거나, 이는 끝 지점에 도달했다는 것이다.
-        // 혹은 searchsize가 1이하가 되면(여기서는 찾았다는 의미이다. asize를 4로 가정하고 밑의 비트연산과 list++을 해보면 알 수 있다.) 해당 사이즈의 연결리스트가 존재할 때 연결리스트로 들어가서 적절한 free 블록을 찾게 된다.
-        if ((list == LISTLIMIT - 1) || (searchsize <= 1) && (segregation_list[list] != NULL)) {
-            bp = segregation_list[list];
-            
-            while ((bp != NULL) && (asize > GET_SIZE(HDRP(bp)))) {
-                bp = SUCC_FREE(bp);
+    fit_stats.searches++;
+    
+    // asize가 속하는 연결리스트부터, 비어있지 않은 연결리스트를 차례로 탐색한다.
+    for (list = list_index(asize); list < LISTLIMIT; list++) {
+        if (segregation_list[list] != NULL) {
+            // 더 뒤의 연결리스트에는 더 큰 블록만 있으므로, 한 연결리스트에서 찾았다면 그 블록이 정책에 맞는 답이 된다.
+            // 크기순으로 정렬되어 있다면 처음 만나는 맞는 블록이 곧 가장 작은 맞는 블록이므로, first/best/good/exact 모두 lower-bound 탐색 한 번이면 된다.
+            if (CLASS_ORDER == SIZE_ORDER && fit_policy != FIT_NEXT) {
+                bp = fit_lower_bound(list, asize);
+            } else switch (fit_policy) {
+            case FIT_NEXT:
+                bp = fit_next(list, asize);
+                break;
+            case FIT_BEST:
+                bp = fit_best(list, asize, 0);
+                break;
+            case FIT_GOOD:
+                bp = fit_best(list, asize, fit_k);
+                break;
+            case FIT_EXACT:
+                bp = fit_exact(list, asize);
+                break;
+            default:
+                bp = fit_first(list, asize);
+                break;
             }
             
             if (bp != NULL) {
+                STAT(stat_search());
                 return bp;
             }
         }
-        
-        searchsize >>= 1;                                                   // seachsize를 2로 나눠가면서(shift 비트연산을 하면서) while문에서 적절한 사이즈를 가진 연결리스트를 찾도록 해준다.
-        list++;
+    }
+    
+    fit_stats.misses++;                                                     // 맞는 블록이 없어 힙을 늘려야 한다.
+    STAT(stat_search());
+    return NULL;
+}
+
+/*
+ * fit_first - first-fit, 연결리스트의 처음부터 탐색해 처음 만나는 맞는 블록을 반환한다.
+ */
+static void *fit_first(int list, size_t asize) {
+    void *bp;
+    
+    for (bp = segregation_list[list]; bp != NULL; bp = SUCC_FREE(bp)) {
+        fit_stats.steps++;
+        if (asize <= GET_SIZE(HDRP(bp))) {
+            return bp;
+        }
     }
     
     return NULL;
 }
 
 /*
- * remove_block - 
+ * fit_next - next-fit, rover에서 연결리스트의 끝까지 탐색한 뒤, 처음부터 rover 직전까지 다시 탐색한다.
+ *     찾은 블록을 rover로 두면, place에서 remove_block이 rover를 그 다음 블록으로 옮겨준다.
+ */
+static void *fit_next(int list, size_t asize) {
+    void *start = (rover[list] != NULL) ? rover[list] : segregation_list[list];
+    void *bp;
+    
+    for (bp = start; bp != NULL; bp = SUCC_FREE(bp)) {
+        fit_stats.steps++;
+        if (asize <= GET_SIZE(HDRP(bp))) {
+            rover[list] = bp;
+            return bp;
+        }
+    }
+    
+    for (bp = segregation_list[list]; bp != start; bp = SUCC_FREE(bp)) {
+        fit_stats.steps++;
+        if (asize <= GET_SIZE(HDRP(bp))) {
+            rover[list] = bp;
+            return bp;
+        }
+    }
+    
+    return NULL;
+}
+
+/*
+ * fit_best - 맞는 블록 중 가장 작은 블록을 반환한다. limit이 0이면 연결리스트 전체를(best-fit),
+ *     0보다 크면 맞는 블록을 limit개 만날 때까지만 탐색한다(good-fit). 크기가 딱 맞는 블록을 만나면 곧바로 멈춘다.
+ */
+static void *fit_best(int list, size_t asize, int limit) {
+    void *bp;
+    void *best = NULL;
+    size_t best_size = 0;
+    size_t csize;
+    int candidates = 0;
+    
+    for (bp = segregation_list[list]; bp != NULL; bp = SUCC_FREE(bp)) {
+        fit_stats.steps++;
+        csize = GET_SIZE(HDRP(bp));
+        if (asize > csize) {
+            continue;
+        }
+        
+        if (best == NULL || csize < best_size) {
+            best = bp;
+            best_size = csize;
+        }
+        
+        candidates++;
+        if (csize == asize || (limit > 0 && candidates >= limit)) {
+            break;
+        }
+    }
+    
+    return best;
+}
+
+/*
+ * fit_exact - 분할하지 않고 그대로 쓸 수 있는 블록(남는 공간이 최소 블록 크기보다 작은 블록)을 먼저 찾는다.
+ *     그런 블록이 없으면 처음 만난 맞는 블록(first-fit)을 반환한다.
+ */
+static void *fit_exact(int list, size_t asize) {
+    void *bp;
+    void *first = NULL;
+    size_t csize;
+    
+    for (bp = segregation_list[list]; bp != NULL; bp = SUCC_FREE(bp)) {
+        fit_stats.steps++;
+        csize = GET_SIZE(HDRP(bp));
+        if (asize > csize) {
+            continue;
+        }
+        
+        if ((csize - asize) < split_min) {                                  // place에서 분할되지 않는 크기이다.
+            return bp;
+        }
+        
+        if (first == NULL) {
+            first = bp;
+        }
+    }
+    
+    return first;
+}
+
+/*
+ * parse_fit_policy - 정책 이름을 FIT_xxx 상수로 바꾼다. 모르는 이름이면 -1을 반환한다.
+ */
+static int parse_fit_policy(const char *name) {
+    int policy;
+    
+    if (name == NULL) {
+        return -1;
+    }
+    
+    for (policy = FIT_FIRST; policy <= FIT_EXACT; policy++) {
+        if (strcmp(name, fit_names[policy]) == 0) {
+            return policy;
+        }
+    }
+    
+    return -1;
+}
+
+/*
+ * mm_set_fit_policy - 다음 mm_init부터 사용할 fit 정책을 정한다. k는 good-fit에서 비교할 후보의 수이다.
+ *     모르는 정책 이름이면 -1을 반환한다.
+ */
+int mm_set_fit_policy(const char *name, int k) {
+    int policy = parse_fit_policy(name);
+    
+    if (policy < 0) {
+        return -1;
+    }
+    
+    fit_requested = policy;
+    fit_requested_k = (k > 0) ? k : FIT_DEFAULT_K;
+    return 0;
+}
+
+/*
+ * mm_set_tunable - 이름으로 정한 매개변수의 값을 바꾼다. 다음 mm_init부터 적용된다.
+ *     chunksize : 힙을 늘릴 때의 최소 크기 (기본값 CHUNKSIZE)
+ *     split     : 분할하고 남은 블록이 가져야 할 최소 크기 (기본값 2 * DSIZE, 이보다 작을 수는 없다.)
+ *     lists     : 사용할 연결리스트의 수 (1 ~ LISTLIMIT). 마지막 연결리스트가 더 큰 블록을 모두 맡는다.
+ *     모르는 이름이거나 허용되지 않는 값이면 -1을 반환한다.
+ */
+int mm_set_tunable(const char *name, long value) {
+    if (strcmp(name, "chunksize") == 0 && value >= 2 * DSIZE) {
+        pending_chunksize = ALIGN(value);
+        return 0;
+    }
+    if (strcmp(name, "split") == 0 && value >= 2 * DSIZE) {
+        pending_split_min = ALIGN(value);
+        return 0;
+    }
+    if (strcmp(name, "lists") == 0 && value >= 1 && value <= LISTLIMIT) {
+        pending_list_limit = value;
+        return 0;
+    }
+    return -1;
+}
+
+/*
+ * mm_get_fit_stats - 마지막 mm_init 이후의 find_fit 탐색 통계를 돌려준다.
+ */
+void mm_get_fit_stats(fit_stats_t *stats) {
+    *stats = fit_stats;
+}
+
+/*
+ * fit_lower_bound - 크기순으로 정렬된 연결리스트에서 asize 이상인 첫 블록을 skip list로 찾는다. O(log n)
+ */
+static void *fit_lower_bound(int list, size_t asize) {
+    void *x = NULL;                                                         // NULL은 각 층의 맨 앞(head)을 뜻한다.
+    void *next;
+    int k;
+    
+    for (k = SKIP_MAXLEVEL - 1; k >= 1; k--) {
+        while ((next = skip_next(list, x, k)) != NULL && GET_SIZE(HDRP(next)) < asize) {
+            fit_stats.steps++;
+            x = next;
+        }
+    }
+    
+    // 위층에서 찾은 블록이 없고 asize가 최소 블록보다 크다면, 맨 앞의 최소 블록들은 건너뛴다.
+    if (x == NULL && asize > MINBLOCK) {
+        x = min_tail[list];
+    }
+    next = (x == NULL) ? segregation_list[list] : SUCC_FREE(x);
+    while (next != NULL && GET_SIZE(HDRP(next)) < asize) {
+        fit_stats.steps++;
+        next = SUCC_FREE(next);
+    }
+    
+    if (next != NULL) {
+        fit_stats.steps++;
+    }
+    return next;
+}
+
+/*
+ * list_index - 블록의 사이즈가 속할 수 있는 사이즈 범위를 가진 연결리스트의 번호를 반환한다.
+ */
+static int list_index(size_t size) {
+    int list;
+    
+    // 작은 블록은 표에서 바로 찾는다.
+    if (size <= SIZE_CLASS_LOOKUP_MAX) {
+        list = size_class_lookup[(size + SIZE_CLASS_GRAIN - 1) / SIZE_CLASS_GRAIN];
+    } else {
+        // 큰 블록은 표의 마지막 칸의 연결리스트부터 최대 크기를 비교해 올라간다. 마지막 연결리스트는 상한이 없다.
+        list = size_class_lookup[SIZE_CLASS_LOOKUP_MAX / SIZE_CLASS_GRAIN];
+        while ((list < LISTLIMIT - 1) && (size > size_class_max[list])) {
+            list++;
+        }
+    }
+    
+    return (list < list_limit) ? list : list_limit - 1;
+}
+
+/*
+ * remove_block - 블록 bp를 seglist에서 속한 연결리스트로부터 제거한다.
  */
 static void remove_block(void *bp) {
-    int list = 0;
-    size_t size = GET_SIZE(HDRP(bp));
+    void *update[SKIP_MAXLEVEL];
+    int list = list_index(GET_SIZE(HDRP(bp)));                              // 지우고자 하는 블록의 사이즈가 속할 수 있는 사이즈 범위를 가진 연결 리스트를 찾는다.
+    int height;
+    int k;
+    
+    STAT(stat_free_block(GET_SIZE(HDRP(bp)), 0));
+    
+    // next-fit의 rover가 지우려는 블록을 가리키고 있다면, 그 다음 블록으로 옮겨준다.
+    if (rover[list] == bp) {
+        rover[list] = SUCC_FREE(bp);
+    }
     
-    // 지우고자 하는 블록의 사이즈가 속할 수 있는 사이즈 범위를 가진 연결 리스트를 찾는다.
-    while ((list < LISTLIMIT - 1) && (size > 1)) {
-        size >>= 1;
-        list++;
+    // 최소 블록들의 마지막 블록을 지운다면 그 앞의 블록(최소 블록이거나 NULL)이 마지막이 된다.
+    if (min_tail[list] == bp) {
+        min_tail[list] = PRED_FREE(bp);
+    }
+    
+    // 크기순 정렬이라면 1층 이상의 skip list에서 먼저 bp를 떼어낸다. 각 층에서 bp 바로 앞의 블록을 위에서부터 찾아 내려온다.
+    if (CLASS_ORDER == SIZE_ORDER && (height = skip_height(bp)) > 1) {
+        skip_find_prev(list, bp, update, height);
+        for (k = 1; k < height; k++) {
+            skip_set_next(list, update[k], k, SKIP_FWD(bp, k));
+        }
     }
     
     if (SUCC_FREE(bp) != NULL) {                                            // 다음 블록이 존재한다면
@@ -358,50 +733,202 @@ static void remove_block(void *bp) {
     return;
 }
 
+/*
+ * insert_block - 블록 bp를 seglist에서 속한 연결리스트에 넣는다.
+ *     SIZE_ORDER라면 skip list를 타고 내려가 (크기, 주소) 순서에 맞는 자리에 넣는다. O(log n)
+ *     최소 블록은 연결리스트의 맨 처음에 넣는다. O(1)
+ */
 static void insert_block(void *bp, size_t size) {
-    int list = 0;
-    void *search_ptr;                                                       // 블록들을 탐색하는 포인터
-    void *insert_ptr = NULL;                                                // search_ptr의 바로 앞 탐색 포인터(실제로 삽입할 곳을 가리키게 되는 포인터)
-    
-    // 추가하고자 하는 블록의 사이즈가 속할 수 있는 사이즈 범위를 가진 연결 리스트를 찾는다.
-    while ((list < LISTLIMIT - 1) && (size > 1)) {
-        size >>= 1;
-        list++;
-    }
-    
-    // 적절한 사이즈 범위를 가진 연결리스트에서 적절한 곳에 넣을 수 있는 블록을 탐색하는 과정이다.
-    // 오름차순으로 저장하기 위해, 나보다 작은 블록은 넘기고 큰 블록을 만났을 때 멈추게 된다. 따라서 실제로 삽입하게 되는 곳은 insert_ptr이 가리키는 곳이다.
-    search_ptr = segregation_list[list];
-    while ((search_ptr != NULL) && (size > GET_SIZE(HDRP(search_ptr)))) {   // 더 큰 사이즈의 free 블록을 만나면 멈춘다.
-        insert_ptr = search_ptr;                                            
-        search_ptr = SUCC_FREE(search_ptr);
-    }
-    // search_ptr이 더 큰 블록이고, insert_ptr은 바로 그 전의 블록을 가리키는 포인터인 상태로 탐색이 끝나게 된다.
-    
-    if (search_ptr != NULL) {                                               // 더 큰 블록이 존재하고
-        if (insert_ptr != NULL) {                                           // 현재 가리키는 블록도 존재한다면 bp를 중간에 끼워 넣어야 한다.
-            SUCC_FREE(bp) = search_ptr;                                     
-            PRED_FREE(bp) = insert_ptr;
-            PRED_FREE(search_ptr) = bp;
-            SUCC_FREE(insert_ptr) = bp;
-        } else {                                                            // 더 큰 블록이 존재하고 현재 가리키는 블록이 존재하지 않는다면(이전 블록이 없다면) 이는 연결리스트의 맨처음임을 말한다.
-            SUCC_FREE(bp) = search_ptr;
-            PRED_FREE(bp) = NULL;
-            PRED_FREE(search_ptr) = bp;
-            segregation_list[list] = bp;                                    // 따라서 bp를 연결리스트의 맨 처음에 삽입하면 된다.
+    void *update[SKIP_MAXLEVEL];
+    int list = list_index(size);                                            // 추가하고자 하는 블록의 사이즈가 속할 수 있는 사이즈 범위를 가진 연결 리스트를 찾는다.
+    void *insert_ptr = NULL;                                                // 0층에서 bp 바로 앞에 오게 될 블록(실제로 삽입할 곳을 가리키게 되는 포인터)
+    void *search_ptr;                                                       // 0층에서 bp 바로 뒤에 오게 될 블록
+    int height = 1;
+    int k;
+    
+    STAT(stat_free_block(size, 1));
+    
+    if (CLASS_ORDER == SIZE_ORDER && size <= MINBLOCK) {
+        // 최소 블록은 같은 크기의 블록들 맨 앞, 즉 연결리스트의 맨 처음에 넣는다. (insert_ptr은 NULL 그대로)
+        if (min_tail[list] == NULL) {
+            min_tail[list] = bp;
+        }
+    }
+    else if (CLASS_ORDER == SIZE_ORDER) {
+        // 블록의 높이를 정하고, level 워드가 있는 블록이라면 기록해둔다. (제거할 때 다시 읽어야 하기 때문이다.)
+        height = skip_random_level(size);
+        if (size > MINBLOCK) {
+            SKIP_LEVEL(bp) = height;
         }
-    } else {                                                                // 더 큰 블록이 존재하지 않고,
-        if (insert_ptr != NULL) {                                           // 이전 블록이 존재한다면
-            SUCC_FREE(bp) = NULL;                                           // 이는 맨 끝 블록임을 말한다.
-            PRED_FREE(bp) = insert_ptr;
-            SUCC_FREE(insert_ptr) = bp;
-        } else {                                                            // 더 큰 블록이 존재하지 않고, 이전 블록도 존재하지 않는다면
-            SUCC_FREE(bp) = NULL;                                           // 추가하려는 블록은 연결리스트의 맨 처음이 된다.
-            PRED_FREE(bp) = NULL;
-            segregation_list[list] = bp;
+        
+        // 오름차순으로 저장하기 위해, 각 층에서 나보다 작은 블록은 넘기고 큰 블록을 만났을 때 멈추게 된다.
+        insert_ptr = skip_find_prev(list, bp, update, height);
+        for (k = 1; k < height; k++) {
+            SKIP_FWD(bp, k) = skip_next(list, update[k], k);
+            skip_set_next(list, update[k], k, bp);
         }
     }
     
+    // insert_ptr이 NULL이면 연결리스트의 맨 처음에 넣는다. (LIFO_ORDER는 항상 맨 처음이다.)
+    search_ptr = (insert_ptr == NULL) ? segregation_list[list] : SUCC_FREE(insert_ptr);
+    SUCC_FREE(bp) = search_ptr;
+    PRED_FREE(bp) = insert_ptr;
+    if (search_ptr != NULL) {
+        PRED_FREE(search_ptr) = bp;
+    }
+    if (insert_ptr != NULL) {
+        SUCC_FREE(insert_ptr) = bp;
+    } else {
+        segregation_list[list] = bp;
+    }
+    
     return;
 }
 
+/*
+ * skip_less - 블록 a가 (크기 bsize, 주소 b)인 블록보다 앞에 와야 하면 1을 반환한다. 크기가 같으면 주소로 비교한다.
+ */
+static int skip_less(void *a, size_t bsize, void *b) {
+    size_t asize = GET_SIZE(HDRP(a));
+    
+    return (asize < bsize) || (asize == bsize && (char *)a < (char *)b);
+}
+
+/*
+ * skip_height - 연결리스트 안에 있는 블록 bp가 몇 개의 층에 걸쳐 있는지 반환한다.
+ */
+static int skip_height(void *bp) {
+    // 최소 블록의 세 번째 워드는 footer이므로 읽으면 안 된다.
+    if (GET_SIZE(HDRP(bp)) <= MINBLOCK) {
+        return 1;
+    }
+    return SKIP_LEVEL(bp);
+}
+
+/*
+ * skip_random_level - 1/2 확률로 한 층씩 올라가는 높이를 정한다. 블록이 담을 수 있는 높이를 넘지 않는다.
+ */
+static int skip_random_level(size_t size) {
+    int height = 1;
+    int capacity;
+    
+    if (size <= MINBLOCK) {
+        return 1;
+    }
+    
+    capacity = SKIP_CAPACITY(size);
+    if (capacity > SKIP_MAXLEVEL) {
+        capacity = SKIP_MAXLEVEL;
+    }
+    
+    // xorshift32 난수 발생기로, 비트를 하나씩 소비하며 층을 올린다.
+    skip_seed ^= skip_seed << 13;
+    skip_seed ^= skip_seed >> 17;
+    skip_seed ^= skip_seed << 5;
+    while (height < capacity && (skip_seed >> (height - 1)) & 1) {
+        height++;
+    }
+    
+    return height;
+}
+
+/*
+ * skip_next - list번 연결리스트의 k층(k >= 1)에서 x의 다음 블록을 반환한다. x가 NULL이면 그 층의 맨 처음 블록을 반환한다.
+ */
+static void *skip_next(int list, void *x, int k) {
+    return (x == NULL) ? skip_head[list][k] : SKIP_FWD(x, k);
+}
+
+/*
+ * skip_set_next - list번 연결리스트의 k층(k >= 1)에서 x의 다음 블록을 next로 바꾼다. x가 NULL이면 그 층의 맨 처음을 바꾼다.
+ */
+static void skip_set_next(int list, void *x, int k, void *next) {
+    if (x == NULL) {
+        skip_head[list][k] = next;
+    } else {
+        SKIP_FWD(x, k) = next;
+    }
+}
+
+/*
+ * skip_find_prev - 맨 위층부터 내려오면서, 각 층에서 bp보다 앞에 오는 마지막 블록을 update[k]에 담는다.
+ *     height층 미만의 update만 채우며, 0층에서 bp 바로 앞의 블록을 반환한다. (없으면 NULL) bp는 최소 블록이 아니어야 한다.
+ */
+static void *skip_find_prev(int list, void *bp, void **update, int height) {
+    size_t size = GET_SIZE(HDRP(bp));
+    void *x = NULL;                                                         // NULL은 각 층의 맨 앞(head)을 뜻한다.
+    void *next;
+    int k;
+    
+    for (k = SKIP_MAXLEVEL - 1; k >= 1; k--) {
+        while ((next = skip_next(list, x, k)) != NULL && skip_less(next, size, bp)) {
+            x = next;
+        }
+        if (k < height) {
+            update[k] = x;
+        }
+    }
+    
+    // 위층에서 찾은 x부터 0층을 이어서 탐색하므로 짧게 끝난다.
+    // 위층에서 찾은 블록이 없다면 맨 앞의 최소 블록들은 건너뛴다. (bp는 최소 블록이 아니므로 그 뒤에 온다.)
+    if (x == NULL) {
+        x = min_tail[list];
+    }
+    next = (x == NULL) ? segregation_list[list] : SUCC_FREE(x);
+    while (next != NULL && next != bp && skip_less(next, size, bp)) {
+        x = next;
+        next = SUCC_FREE(next);
+    }
+    
+    return x;
+}
+
+#if MM_STATS
+/*
+ * mm_stats - mm_init 이후의 통계를 out에 담는다. 힙 크기와 free 블록이 아닌 바이트 수는 지금 값이다.
+ */
+void mm_stats(mm_stats_t *out) {
+    *out = stats;
+    out->heap_bytes = mem_heapsize();
+    out->live_bytes = mem_heapsize() - stat_free_bytes;
+}
+
+/*
+ * stat_free_block - size 바이트의 블록이 연결리스트에 들어오면(added) 혹은 나가면, 크기 계급별 수와 free 바이트 수를 고친다.
+ */
+static void stat_free_block(size_t size, int added) {
+    int k = MAX(stat_log2(size) - 4, 0);                                    // 16바이트 이상 32바이트 미만이 0번 계급이다.
+    
+    if (k >= MM_STATS_CLASSES) {
+        k = MM_STATS_CLASSES - 1;
+    }
+    if (added) {
+        stats.free_blocks[k]++;
+        stat_free_bytes += size;
+    } else {
+        stats.free_blocks[k]--;
+        stat_free_bytes -= size;
+    }
+}
+
+/*
+ * stat_search - 끝난 탐색이 살펴본 블록 수(지난 탐색 이후 늘어난 fit_stats.steps)를 히스토그램에 더한다.
+ */
+static void stat_search(void) {
+    unsigned long steps = fit_stats.steps - stat_steps;
+    int b = (steps == 0) ? 0 : stat_log2(steps) + 1;                        // 0, 1, 2-3, 4-7, ... 개
+    
+    if (b >= MM_STATS_BUCKETS) {
+        b = MM_STATS_BUCKETS - 1;
+    }
+    stats.search_len[b]++;
+    stat_steps = fit_stats.steps;
+}
+
+/*
+ * stat_log2 - 0보다 큰 n의 log2를 내림한 값
+ */
+static int stat_log2(size_t n) {
+    return (int)(8 * sizeof(unsigned long) - 1) - __builtin_clzl(n);
+}
+#endif
@@ -0,0 +1,607 @@
+/*
+ * mtbench.c - multi-threaded benchmarks for the mm package and libc.
+ *
+ * The traces only exercise an allocator from one thread. These
+ * benchmarks, modelled on the standard ones from the allocator
+ * literature, run a fixed amount of work per thread at 1, 2, 4, ...
+ * threads and report the throughput, how it scales against one thread,
+ * the worst per-thread 99th percentile latency of a malloc or free,
+ * and the memory blowup (heap size over the peak of the live bytes):
+ *
+ *   larson        server churn: each thread replaces random blocks in
+ *                 its own set, and the sets move to another thread
+ *                 every round, so that blocks are freed remotely
+ *   threadtest    each thread allocates a batch of blocks, then frees
+ *                 them all, over and over
+ *   xmalloc       producer/consumer pairs: one thread allocates and
+ *                 hands the blocks over a ring to another that frees
+ *   cache-scratch each thread frees a small block allocated by the main
+ *                 thread next to the others', then mallocs and writes
+ *                 its own small blocks; an allocator that hands back
+ *                 the same cache lines to different threads shows
+ *                 false sharing
+ *
+ * Blowup is only reported for the mm package, whose heap starts empty
+ * in every run. The libc arenas live on from run to run (and from the
+ * libc trace runs), so what libc holds says little about one run.
+ *
+ * The mm package has one heap that only its owner may change, so the
+ * mm calls of the benchmark threads are serialized by a lock. Frees
+ * from these threads still take the mm package's remote free path,
+ * since none of them is the thread that called mm_init.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <malloc.h>
+
+#include "mtbench.h"
+#include "mm.h"
+#include "memlib.h"
+
+/* Misc */
+#define MT_MAXTHREADS   64     /* max number of benchmark threads */
+#define MT_SAMPLE        8     /* time one malloc/free in MT_SAMPLE */
+#define MT_MAXSAMPLES 8192     /* max latency samples per thread */
+#define MT_FLUSH        64     /* ops between updates of the live bytes */
+#define MT_MINLIVE   16384     /* smallest live peak to compute blowup for */
+
+/* Benchmark parameters (work per thread) */
+#define LARSON_SLOTS   500     /* blocks in each thread's set */
+#define LARSON_ROUNDS    4     /* rounds, after each the sets move */
+#define LARSON_OPS   10000     /* block replacements per round */
+#define LARSON_MIN      16     /* smallest and ... */
+#define LARSON_MAX     256     /* ... largest block size */
+#define THREADTEST_ITERS 50    /* batches per thread */
+#define THREADTEST_OBJS 1000   /* blocks per batch */
+#define THREADTEST_SIZE  64    /* block size */
+#define XMALLOC_OPS  50000     /* blocks passed from each producer */
+#define XMALLOC_MIN     16     /* smallest and ... */
+#define XMALLOC_MAX    512     /* ... largest block size */
+#define XMALLOC_RING   256     /* entries in a producer/consumer ring */
+#define SCRATCH_ITERS 2000     /* mallocs per thread */
+#define SCRATCH_WRITES 500     /* writes to each block */
+#define SCRATCH_SIZE     8     /* block size */
+
+/* An allocator under test */
+typedef struct {
+    char *name;
+    void *(*malloc)(size_t size);
+    void (*free)(void *ptr);
+    void (*reset)(void);        /* start each run with an empty heap */
+    double (*heap_bytes)(void); /* bytes obtained from the system (or NULL) */
+} mt_alloc_t;
+
+/* A single-producer, single-consumer ring of blocks */
+typedef struct {
+    void *ptr[XMALLOC_RING];
+    int size[XMALLOC_RING];
+    unsigned int head;          /* next entry to fill (producer) */
+    char pad[64];               /* keep head and tail on separate lines */
+    unsigned int tail;          /* next entry to drain (consumer) */
+} mt_ring_t;
+
+/* The state of one benchmark thread */
+typedef struct {
+    int id;                     /* thread number, from 0 */
+    int nthreads;               /* number of threads in the run */
+    unsigned int seed;          /* random number state */
+    mt_alloc_t *alloc;          /* allocator under test */
+    long ops;                   /* number of mallocs and frees */
+    double *lat;                /* sampled latencies (usecs) ... */
+    int nlat;                   /* ... and their number */
+    long live;                  /* live bytes not yet added to live_bytes */
+    long live_max;              /* ... and their max since the last update */
+    int pending;                /* ops since the last update */
+    void **slots;               /* larson: blocks of the set */
+    int *sizes;                 /* larson: ... and their sizes */
+    mt_ring_t *ring;            /* xmalloc: ring to the consumer */
+    int role;                   /* xmalloc: 0 producer, 1 consumer, 2 both */
+    char *obj;                  /* cache-scratch: block from the main thread */
+} mt_thread_t;
+
+/* A benchmark */
+typedef struct {
+    char *name;
+    void *(*run)(void *arg);    /* body of each thread */
+    void (*setup)(mt_thread_t *threads, int n); /* before the threads start */
+} mt_bench_t;
+
+/* Shared state of a run */
+static mt_thread_t mt_threads[MT_MAXTHREADS];
+static pthread_barrier_t mt_start;  /* workers and main thread */
+static pthread_barrier_t mt_round;  /* workers only */
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+static long live_bytes;             /* bytes allocated and not freed */
+static long peak_live;              /* ... and their peak in the run */
+
+/* Allocators */
+static void *mm_locked_malloc(size_t size);
+static void mm_locked_free(void *ptr);
+static void mm_reset(void);
+static double mm_heap_bytes(void);
+static void libc_reset(void);
+
+/* Benchmarks */
+static void *larson(void *arg);
+static void *threadtest(void *arg);
+static void *xmalloc(void *arg);
+static void *cache_scratch(void *arg);
+static void xmalloc_setup(mt_thread_t *threads, int n);
+static void scratch_setup(mt_thread_t *threads, int n);
+
+/* Helpers */
+static void run_bench(mt_bench_t *bench, mt_alloc_t *alloc, int n,
+		      double *base_kops);
+static void *timed_malloc(mt_thread_t *t, size_t size);
+static void timed_free(mt_thread_t *t, void *ptr, size_t size);
+static void account(mt_thread_t *t, long delta);
+static void flush_live(mt_thread_t *t);
+static unsigned int rand_range(mt_thread_t *t, unsigned int lo, unsigned int hi);
+static double now_usecs(void);
+static int compare_double(const void *a, const void *b);
+static void mt_error(char *msg);
+
+static mt_alloc_t allocs[] = {
+    {"mm", mm_locked_malloc, mm_locked_free, mm_reset, mm_heap_bytes},
+    {"libc", malloc, free, libc_reset, NULL},
+};
+
+static mt_bench_t benches[] = {
+    {"larson", larson, NULL},
+    {"threadtest", threadtest, NULL},
+    {"xmalloc", xmalloc, xmalloc_setup},
+    {"cache-scratch", cache_scratch, scratch_setup},
+};
+
+/*
+ * mt_bench - run every benchmark with every allocator at 1, 2, 4, ...
+ *     threads, up to max_threads, and print the results
+ */
+void mt_bench(int max_threads)
+{
+    int b, a, n;
+    double base_kops;
+
+    if (max_threads < 1 || max_threads > MT_MAXTHREADS)
+	mt_error("ERROR: the number of threads must be from 1 to 64");
+
+    printf("Multi-threaded benchmarks (mm calls serialized by a lock):\n");
+    printf("%-14s%6s%8s%9s%9s%9s%8s\n",
+	   "bench", "alloc", "threads", "Kops", "scaling", "p99 us", "blowup");
+    for (b = 0; b < sizeof(benches) / sizeof(benches[0]); b++) {
+	for (a = 0; a < sizeof(allocs) / sizeof(allocs[0]); a++) {
+	    base_kops = 0;
+	    for (n = 1; n < max_threads; n *= 2)
+		run_bench(&benches[b], &allocs[a], n, &base_kops);
+	    run_bench(&benches[b], &allocs[a], max_threads, &base_kops);
+	}
+    }
+}
+
+/*
+ * run_bench - run one benchmark with n threads and print its results.
+ *     base_kops is the throughput of the 1 thread run, which the
+ *     scaling of the others is relative to.
+ */
+static void run_bench(mt_bench_t *bench, mt_alloc_t *alloc, int n,
+		      double *base_kops)
+{
+    pthread_t tid[MT_MAXTHREADS];
+    double start, secs, ops, kops, p99, worst_p99, heap;
+    int i;
+
+    alloc->reset();
+    live_bytes = 0;
+    peak_live = 0;
+    pthread_barrier_init(&mt_start, NULL, n + 1);
+    pthread_barrier_init(&mt_round, NULL, n);
+
+    memset(mt_threads, 0, sizeof(mt_threads));
+    for (i = 0; i < n; i++) {
+	mt_threads[i].id = i;
+	mt_threads[i].nthreads = n;
+	mt_threads[i].seed = 2463534242u + i;
+	mt_threads[i].alloc = alloc;
+	if ((mt_threads[i].lat = malloc(MT_MAXSAMPLES * sizeof(double))) == NULL)
+	    mt_error("ERROR: malloc failed in run_bench");
+    }
+    if (bench->setup != NULL)
+	bench->setup(mt_threads, n);
+
+    /* Start the threads together and time them until the last is done */
+    for (i = 0; i < n; i++)
+	if (pthread_create(&tid[i], NULL, bench->run, &mt_threads[i]) != 0)
+	    mt_error("ERROR: pthread_create failed in run_bench");
+    pthread_barrier_wait(&mt_start);
+    start = now_usecs();
+    for (i = 0; i < n; i++)
+	pthread_join(tid[i], NULL);
+    secs = (now_usecs() - start) / 1e6;
+    heap = alloc->heap_bytes ? alloc->heap_bytes() : 0;
+
+    /* Collect the op counts and the worst per-thread tail latency */
+    ops = 0;
+    worst_p99 = 0;
+    for (i = 0; i < n; i++) {
+	ops += mt_threads[i].ops;
+	if (mt_threads[i].nlat > 0) {
+	    qsort(mt_threads[i].lat, mt_threads[i].nlat, sizeof(double),
+		  compare_double);
+	    p99 = mt_threads[i].lat[(int)(mt_threads[i].nlat * 0.99)];
+	    if (p99 > worst_p99)
+		worst_p99 = p99;
+	}
+	free(mt_threads[i].lat);
+	free(mt_threads[i].ring);
+    }
+    pthread_barrier_destroy(&mt_start);
+    pthread_barrier_destroy(&mt_round);
+
+    kops = (ops / 1e3) / secs;
+    if (n == 1)
+	*base_kops = kops;
+    printf("%-14s%6s%8d%9.0f%8.2fx%9.2f",
+	   bench->name, alloc->name, n, kops,
+	   *base_kops > 0 ? kops / *base_kops : 0, worst_p99);
+    if (heap > 0 && peak_live >= MT_MINLIVE)
+	printf("%7.2fx\n", heap / peak_live);
+    else
+	printf("%8s\n", "-");
+}
+
+/*********************
+ * The allocators
+ *********************/
+
+/*
+ * mm_locked_malloc, mm_locked_free - the mm package, serialized
+ */
+static void *mm_locked_malloc(size_t size)
+{
+    void *p;
+
+    pthread_mutex_lock(&mm_lock);
+    p = mm_malloc(size);
+    pthread_mutex_unlock(&mm_lock);
+    return p;
+}
+
+static void mm_locked_free(void *ptr)
+{
+    pthread_mutex_lock(&mm_lock);
+    mm_free(ptr);
+    pthread_mutex_unlock(&mm_lock);
+}
+
+/*
+ * mm_reset - start the mm package over on an empty simulated heap
+ */
+static void mm_reset(void)
+{
+    mem_reset_brk();
+    if (mm_init() < 0)
+	mt_error("ERROR: mm_init failed in mm_reset");
+}
+
+/*
+ * mm_heap_bytes - the size of the simulated heap
+ */
+static double mm_heap_bytes(void)
+{
+    return (double)mem_heapsize();
+}
+
+/*
+ * libc_reset - return the free libc memory to the system
+ */
+static void libc_reset(void)
+{
+    malloc_trim(0);
+}
+
+/*********************
+ * The benchmarks
+ *********************/
+
+/*
+ * larson - replace random blocks of the thread's set with blocks of
+ *     random sizes. After each round, every thread takes over the set
+ *     of the next thread and frees its blocks from then on.
+ */
+static void *larson(void *arg)
+{
+    mt_thread_t *t = (mt_thread_t *)arg;
+    mt_thread_t *next = &mt_threads[(t->id + 1) % t->nthreads];
+    void **slots;
+    int *sizes;
+    int round, i, k;
+
+    pthread_barrier_wait(&mt_start);
+
+    if ((t->slots = malloc(LARSON_SLOTS * sizeof(void *))) == NULL ||
+	(t->sizes = malloc(LARSON_SLOTS * sizeof(int))) == NULL)
+	mt_error("ERROR: malloc failed in larson");
+    for (i = 0; i < LARSON_SLOTS; i++) {
+	t->sizes[i] = rand_range(t, LARSON_MIN, LARSON_MAX);
+	t->slots[i] = timed_malloc(t, t->sizes[i]);
+    }
+
+    for (round = 0; round < LARSON_ROUNDS; round++) {
+	for (i = 0; i < LARSON_OPS; i++) {
+	    k = rand_range(t, 0, LARSON_SLOTS - 1);
+	    timed_free(t, t->slots[k], t->sizes[k]);
+	    t->sizes[k] = rand_range(t, LARSON_MIN, LARSON_MAX);
+	    t->slots[k] = timed_malloc(t, t->sizes[k]);
+	}
+
+	/* Hand the set over: read the next thread's set, then switch */
+	pthread_barrier_wait(&mt_round);
+	slots = next->slots;
+	sizes = next->sizes;
+	pthread_barrier_wait(&mt_round);
+	t->slots = slots;
+	t->sizes = sizes;
+    }
+
+    for (i = 0; i < LARSON_SLOTS; i++)
+	timed_free(t, t->slots[i], t->sizes[i]);
+    pthread_barrier_wait(&mt_round);
+    free(t->slots);
+    free(t->sizes);
+    flush_live(t);
+    return NULL;
+}
+
+/*
+ * threadtest - allocate a batch of equal-sized blocks, then free them
+ */
+static void *threadtest(void *arg)
+{
+    mt_thread_t *t = (mt_thread_t *)arg;
+    void *objs[THREADTEST_OBJS];
+    int iter, i;
+
+    pthread_barrier_wait(&mt_start);
+
+    for (iter = 0; iter < THREADTEST_ITERS; iter++) {
+	for (i = 0; i < THREADTEST_OBJS; i++)
+	    objs[i] = timed_malloc(t, THREADTEST_SIZE);
+	for (i = 0; i < THREADTEST_OBJS; i++)
+	    timed_free(t, objs[i], THREADTEST_SIZE);
+    }
+    flush_live(t);
+    return NULL;
+}
+
+/*
+ * xmalloc_setup - pair up the threads as producer and consumer, each
+ *     pair with its own ring. An odd thread out does both jobs.
+ */
+static void xmalloc_setup(mt_thread_t *threads, int n)
+{
+    int i;
+
+    for (i = 0; i + 1 < n; i += 2) {
+	if ((threads[i].ring = calloc(1, sizeof(mt_ring_t))) == NULL)
+	    mt_error("ERROR: calloc failed in xmalloc_setup");
+	threads[i].role = 0;
+	threads[i+1].ring = NULL;
+	threads[i+1].role = 1;
+    }
+    if (n % 2)
+	threads[n-1].role = 2;
+}
+
+/*
+ * xmalloc - producers allocate blocks of random sizes and pass them to
+ *     their consumer, which frees them
+ */
+static void *xmalloc(void *arg)
+{
+    mt_thread_t *t = (mt_thread_t *)arg;
+    mt_ring_t *ring;
+    void *objs[XMALLOC_RING];
+    int sizes[XMALLOC_RING];
+    unsigned int head, tail;
+    int i, k;
+
+    pthread_barrier_wait(&mt_start);
+
+    if (t->role == 2) {
+	/* Alone: produce a ring's worth, then consume it */
+	for (i = 0; i < XMALLOC_OPS; i += XMALLOC_RING) {
+	    for (k = 0; k < XMALLOC_RING; k++) {
+		sizes[k] = rand_range(t, XMALLOC_MIN, XMALLOC_MAX);
+		objs[k] = timed_malloc(t, sizes[k]);
+	    }
+	    for (k = 0; k < XMALLOC_RING; k++)
+		timed_free(t, objs[k], sizes[k]);
+	}
+    }
+    else if (t->role == 0) {
+	ring = t->ring;
+	for (i = 0; i < XMALLOC_OPS; i++) {
+	    head = ring->head;
+	    while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == XMALLOC_RING)
+		sched_yield();
+	    ring->size[head % XMALLOC_RING] = rand_range(t, XMALLOC_MIN, XMALLOC_MAX);
+	    ring->ptr[head % XMALLOC_RING] =
+		timed_malloc(t, ring->size[head % XMALLOC_RING]);
+	    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	}
+    }
+    else {
+	ring = mt_threads[t->id - 1].ring;
+	for (i = 0; i < XMALLOC_OPS; i++) {
+	    tail = ring->tail;
+	    while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+		sched_yield();
+	    timed_free(t, ring->ptr[tail % XMALLOC_RING],
+		       ring->size[tail % XMALLOC_RING]);
+	    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	}
+    }
+    flush_live(t);
+    return NULL;
+}
+
+/*
+ * scratch_setup - allocate one small block per thread from the main
+ *     thread, so that the blocks sit next to each other
+ */
+static void scratch_setup(mt_thread_t *threads, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+	if ((threads[i].obj = threads[i].alloc->malloc(SCRATCH_SIZE)) == NULL)
+	    mt_error("ERROR: malloc failed in scratch_setup");
+	account(&threads[i], SCRATCH_SIZE);
+    }
+}
+
+/*
+ * cache_scratch - free the block from the main thread, then malloc,
+ *     write and free small blocks. The writes share cache lines with
+ *     other threads if the allocator reuses their neighbours' blocks.
+ */
+static void *cache_scratch(void *arg)
+{
+    mt_thread_t *t = (mt_thread_t *)arg;
+    volatile char *p;
+    int iter, i, k;
+
+    pthread_barrier_wait(&mt_start);
+
+    timed_free(t, t->obj, SCRATCH_SIZE);
+    for (iter = 0; iter < SCRATCH_ITERS; iter++) {
+	p = timed_malloc(t, SCRATCH_SIZE);
+	for (i = 0; i < SCRATCH_WRITES; i++)
+	    for (k = 0; k < SCRATCH_SIZE; k++)
+		p[k]++;
+	timed_free(t, (void *)p, SCRATCH_SIZE);
+    }
+    flush_live(t);
+    return NULL;
+}
+
+/*********************
+ * Helpers
+ *********************/
+
+/*
+ * timed_malloc - malloc size bytes for thread t, timing one call in
+ *     MT_SAMPLE, and count the bytes as live
+ */
+static void *timed_malloc(mt_thread_t *t, size_t size)
+{
+    void *p;
+    double start;
+
+    if (t->ops++ % MT_SAMPLE == 0 && t->nlat < MT_MAXSAMPLES) {
+	start = now_usecs();
+	p = t->alloc->malloc(size);
+	t->lat[t->nlat++] = now_usecs() - start;
+    }
+    else {
+	p = t->alloc->malloc(size);
+    }
+    if (p == NULL)
+	mt_error("ERROR: malloc failed in a benchmark thread");
+    account(t, size);
+    return p;
+}
+
+/*
+ * timed_free - free a block of size bytes for thread t, timing one call
+ *     in MT_SAMPLE
+ */
+static void timed_free(mt_thread_t *t, void *ptr, size_t size)
+{
+    double start;
+
+    if (t->ops++ % MT_SAMPLE == 0 && t->nlat < MT_MAXSAMPLES) {
+	start = now_usecs();
+	t->alloc->free(ptr);
+	t->lat[t->nlat++] = now_usecs() - start;
+    }
+    else {
+	t->alloc->free(ptr);
+    }
+    account(t, -(long)size);
+}
+
+/*
+ * account - add delta to the live bytes of thread t. The shared count
+ *     and its peak are only updated every MT_FLUSH ops, to keep the
+ *     threads from contending for them on every call. The peak of the
+ *     thread's own count in between is added to the shared count as
+ *     it was, so short peaks are not lost.
+ */
+static void account(mt_thread_t *t, long delta)
+{
+    t->live += delta;
+    if (t->live > t->live_max)
+	t->live_max = t->live;
+    if (++t->pending == MT_FLUSH)
+	flush_live(t);
+}
+
+static void flush_live(mt_thread_t *t)
+{
+    long cur, peak;
+
+    cur = __atomic_add_fetch(&live_bytes, t->live, __ATOMIC_RELAXED);
+    cur += t->live_max - t->live;
+    peak = __atomic_load_n(&peak_live, __ATOMIC_RELAXED);
+    while (cur > peak &&
+	   !__atomic_compare_exchange_n(&peak_live, &peak, cur, 1,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	;
+    t->live = 0;
+    t->live_max = 0;
+    t->pending = 0;
+}
+
+/*
+ * rand_range - a random number from lo to hi for thread t (xorshift)
+ */
+static unsigned int rand_range(mt_thread_t *t, unsigned int lo, unsigned int hi)
+{
+    t->seed ^= t->seed << 13;
+    t->seed ^= t->seed >> 17;
+    t->seed ^= t->seed << 5;
+    return lo + t->seed % (hi - lo + 1);
+}
+
+/*
+ * now_usecs - the monotonic clock in usecs
+ */
+static double now_usecs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double da = *(double *)a;
+    double db = *(double *)b;
+
+    return (da > db) - (da < db);
+}
+
+/*
+ * mt_error - report an error and terminate
+ */
+static void mt_error(char *msg)
+{
+    printf("%s\n", msg);
+    exit(1);
+}
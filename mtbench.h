@@ -0,0 +1,5 @@
+/*
+ * mtbench.h - multi-threaded allocator benchmarks
+ */
+
+void mt_bench(int max_threads);
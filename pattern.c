@@ -0,0 +1,164 @@
+/*
+ * pattern.c - Fill and check the payloads of mdriver's correctness runs
+ *
+ * Each block's payload is filled with a 64-bit pattern derived from its
+ * id, so that a block overwritten by another block's data (or by the
+ * allocator's metadata) does not look intact. Since the checks read
+ * every live payload, pattern_check compares 32 or 16 bytes at a time
+ * with AVX2 or SSE2 where the CPU has them. The vector versions are
+ * compiled with target attributes and chosen at run time, so that the
+ * driver still runs on CPUs without them.
+ */
+#include <string.h>
+
+#include "pattern.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define HAVE_X86_SIMD 0
+#endif
+
+typedef size_t (*check_funct)(const unsigned char *, size_t,
+			      unsigned long long);
+
+/* function prototypes */
+static size_t check_scalar(const unsigned char *p, size_t size,
+			   unsigned long long pattern);
+static void pattern_init(void);
+
+static check_funct check = NULL;     /* chosen on the first check */
+static const char *check_isa = NULL;
+
+/*
+ * pattern_of - The pattern of block id: the splitmix64 hash of id, so
+ *     that neighboring ids get unrelated patterns
+ */
+unsigned long long pattern_of(int id)
+{
+    unsigned long long z = (unsigned long long)id + 0x9e3779b97f4a7c15ULL;
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * pattern_fill - Fill size bytes at p with copies of pattern
+ */
+void pattern_fill(void *p, size_t size, unsigned long long pattern)
+{
+    unsigned char *q = (unsigned char *)p;
+    size_t j;
+
+    for (j = 0; j + 8 <= size; j += 8)
+	memcpy(q + j, &pattern, 8);
+    memcpy(q + j, &pattern, size - j);
+}
+
+/*
+ * pattern_check - Find the first byte of size bytes at p that does not
+ *     hold pattern; return size if there is none
+ */
+size_t pattern_check(const void *p, size_t size, unsigned long long pattern)
+{
+    if (check == NULL)
+	pattern_init();
+    return check((const unsigned char *)p, size, pattern);
+}
+
+/*
+ * pattern_isa - The instruction set of pattern_check
+ */
+const char *pattern_isa(void)
+{
+    if (check == NULL)
+	pattern_init();
+    return check_isa;
+}
+
+/*
+ * check_scalar - pattern_check one byte at a time
+ */
+static size_t check_scalar(const unsigned char *p, size_t size,
+			   unsigned long long pattern)
+{
+    unsigned char bytes[8];
+    size_t j;
+
+    memcpy(bytes, &pattern, 8);
+    for (j = 0; j < size; j++)
+	if (p[j] != bytes[j & 7])
+	    return j;
+    return size;
+}
+
+#if HAVE_X86_SIMD
+/*
+ * check_sse2 - pattern_check 16 bytes at a time. The payload is only
+ *     ALIGNMENT-byte aligned, so the loads are unaligned. A mismatch is
+ *     located by check_scalar.
+ */
+__attribute__((target("sse2")))
+static size_t check_sse2(const unsigned char *p, size_t size,
+			 unsigned long long pattern)
+{
+    __m128i want = _mm_set1_epi64x((long long)pattern);
+    size_t j;
+
+    for (j = 0; j + 16 <= size; j += 16) {
+	__m128i got = _mm_loadu_si128((const __m128i *)(p + j));
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(got, want)) != 0xffff)
+	    break;
+    }
+    return j + check_scalar(p + j, size - j, pattern);
+}
+
+/*
+ * check_avx2 - pattern_check 64 bytes per iteration, in two 32-byte
+ *     compares whose results are combined before the one branch
+ */
+__attribute__((target("avx2")))
+static size_t check_avx2(const unsigned char *p, size_t size,
+			 unsigned long long pattern)
+{
+    __m256i want = _mm256_set1_epi64x((long long)pattern);
+    size_t j;
+
+    for (j = 0; j + 64 <= size; j += 64) {
+	__m256i a = _mm256_loadu_si256((const __m256i *)(p + j));
+	__m256i b = _mm256_loadu_si256((const __m256i *)(p + j + 32));
+	__m256i ok = _mm256_and_si256(_mm256_cmpeq_epi8(a, want),
+				      _mm256_cmpeq_epi8(b, want));
+	if (_mm256_movemask_epi8(ok) != -1)
+	    break;
+    }
+    for (; j + 32 <= size; j += 32) {
+	__m256i a = _mm256_loadu_si256((const __m256i *)(p + j));
+	if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, want)) != -1)
+	    break;
+    }
+    return j + check_scalar(p + j, size - j, pattern);
+}
+#endif
+
+/*
+ * pattern_init - Choose the fastest check that the CPU supports
+ */
+static void pattern_init(void)
+{
+    check = check_scalar;
+    check_isa = "scalar";
+#if HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+	check = check_avx2;
+	check_isa = "AVX2";
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+	check = check_sse2;
+	check_isa = "SSE2";
+    }
+#endif
+}
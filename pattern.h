@@ -0,0 +1,17 @@
+/*
+ * Payload patterns for mdriver's correctness checks
+ */
+#include <stddef.h>
+
+/* The 64-bit pattern that fills the payload of block id */
+unsigned long long pattern_of(int id);
+
+/* Fill size bytes at p with pattern, starting with its lowest byte */
+void pattern_fill(void *p, size_t size, unsigned long long pattern);
+
+/* Return the offset of the first of size bytes at p that does not hold
+   pattern (as pattern_fill left it), or size if they all do */
+size_t pattern_check(const void *p, size_t size, unsigned long long pattern);
+
+/* The instruction set that pattern_check uses on this machine */
+const char *pattern_isa(void);
@@ -0,0 +1,248 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+use Getopt::Std;
+
+#######################################################################
+# sweep - search the tuning parameters of the mm package
+#
+# This script runs mdriver once per configuration of the mm package's
+# tuning parameters, several runs at a time, and reports the average
+# utilization and throughput of each configuration, the configurations
+# on the util/Kops Pareto frontier, and the best configuration for a
+# given weight of utilization against throughput.
+#
+# Each parameter is given as name=value,value,... The name "policy"
+# selects the fit policy (mdriver -p); every other name is passed to
+# mm_set_tunable (mdriver -T name=value). By default every combination
+# of the values is run (a grid search); with -r only that many distinct
+# random combinations are.
+#
+# Runs that share the machine disturb each other's timings, so use -j 1
+# when the throughput numbers matter more than the turnaround.
+#
+#######################################################################
+
+$| = 1; # autoflush output on every print statement
+
+#
+# void usage(void) - print help message and terminate
+#
+sub usage
+{
+    printf STDERR "$_[0]\n";
+    printf STDERR "Usage: $0 [-h] [-j <jobs>] [-r <n>] [-s <seed>] [-w <weight>]\n";
+    printf STDERR "       [-m <mdriver args>] <name>=<value>[,<value>...]...\n";
+    printf STDERR "Options:\n";
+    printf STDERR "  -h          Print this message\n";
+    printf STDERR "  -j <jobs>   Run this many mdrivers at a time (default: #cpus)\n";
+    printf STDERR "  -r <n>      Run n random configurations instead of the grid\n";
+    printf STDERR "  -s <seed>   Seed for -r (default 1)\n";
+    printf STDERR "  -w <weight> Weight of util for the best configuration\n";
+    printf STDERR "              (default: UTIL_WEIGHT in config.h)\n";
+    printf STDERR "  -m <args>   Extra arguments for mdriver, e.g. \"-t traces\"\n";
+    printf STDERR "Example: $0 -j 4 chunksize=1024,4096 split=16,32 policy=first,best\n";
+    die "\n" ;
+}
+
+#
+# string mdriver_args(int config) - the mdriver options for a configuration
+#
+sub mdriver_args
+{
+    my $config = $_[0];
+    my $args = "";
+    my $k;
+
+    for ($k = 0; $k < @names; $k++) {
+	if ($names[$k] eq "policy") {
+	    $args .= " -p $configs[$config][$k]";
+	}
+	else {
+	    $args .= " -T $names[$k]=$configs[$config][$k]";
+	}
+    }
+    return $args;
+}
+
+#
+# string config_name(int config) - a configuration, as name=value ...
+#
+sub config_name
+{
+    my $config = $_[0];
+    my @settings = ();
+    my $k;
+
+    for ($k = 0; $k < @names; $k++) {
+	push @settings, "$names[$k]=$configs[$config][$k]";
+    }
+    return join(" ", @settings);
+}
+
+#
+# void collect(int config, filehandle fh) - read the output of the
+# mdriver run for a configuration and record its results
+#
+sub collect
+{
+    my ($config, $fh) = @_;
+    my $line;
+
+    $valid[$config] = 0;
+    while ($line = <$fh>) {
+	# Total util% dist line% page% spread ops secs Kops
+	if ($line =~ /^Total\s+(\d+)%(\s+\S+){4}\s+(\d+)\s+([\d.]+)\s+(\d+)/) {
+	    $util[$config] = $1 / 100;
+	    $kops[$config] = $5;
+	    $valid[$config] = 1;
+	}
+	if ($line =~ /^Throughput cap = (\d+) Kops/) {
+	    $cap[$config] = $1;
+	}
+	if ($line =~ /^Terminated with/ or $line =~ /^ERROR/) {
+	    $valid[$config] = 0;
+	}
+    }
+    close $fh;
+    if ($? != 0) {
+	$valid[$config] = 0;
+    }
+}
+
+##############
+# Main routine
+##############
+
+#
+# Parse and check the command line arguments
+#
+getopts('hj:r:s:w:m:');
+if ($opt_h) {
+    usage("");
+}
+if (!@ARGV) {
+    usage("$0: ERROR: no parameters to sweep");
+}
+if (! -x "./mdriver") {
+    usage("$0: ERROR: no ./mdriver; run make first");
+}
+
+$jobs = $opt_j;
+if (!$jobs) {
+    $jobs = `getconf _NPROCESSORS_ONLN 2>/dev/null`;
+    chomp($jobs);
+    $jobs = 1 if (!$jobs or $jobs < 1);
+}
+$weight = $opt_w;
+if (!defined($weight)) {
+    $weight = 0.60;
+    if (open CONFIG, "<config.h") {
+	while ($line = <CONFIG>) {
+	    if ($line =~ /^#define\s+UTIL_WEIGHT\s+([\d.]+)/) {
+		$weight = $1;
+	    }
+	}
+	close CONFIG;
+    }
+}
+$extra = defined($opt_m) ? $opt_m : "";
+
+@names = ();
+@values = ();
+foreach $arg (@ARGV) {
+    ($name, $list) = split("=", $arg, 2);
+    if (!$name or !defined($list) or $list eq "") {
+	usage("$0: ERROR: $arg is not of the form name=value,...");
+    }
+    push @names, $name;
+    push @values, [split(",", $list)];
+}
+
+#
+# Build the list of configurations: the whole grid, or -r distinct
+# random points of it. Each configuration is a list of values, one per
+# name.
+#
+@configs = ([]);
+for ($k = 0; $k < @names; $k++) {
+    @grid = ();
+    foreach $config (@configs) {
+	foreach $value (@{$values[$k]}) {
+	    push @grid, [@$config, $value];
+	}
+    }
+    @configs = @grid;
+}
+if ($opt_r and $opt_r < @configs) {
+    srand(defined($opt_s) ? $opt_s : 1);
+    for ($i = $#configs; $i > 0; $i--) {
+	$j = int(rand($i + 1));
+	@configs[$i, $j] = @configs[$j, $i];
+    }
+    splice(@configs, $opt_r);
+}
+
+#
+# Run the configurations, at most $jobs at a time. Finished runs are
+# collected in order, while the later ones keep running.
+#
+printf STDERR "Running %d configurations, %d at a time\n", scalar(@configs), $jobs;
+@running = ();
+for ($i = 0; $i < @configs; $i++) {
+    if (@running == $jobs) {
+	($config, $fh) = @{shift @running};
+	collect($config, $fh);
+    }
+    $cmd = "./mdriver -v -a -w $weight $extra" . mdriver_args($i) . " 2>&1";
+    open my $fh, "$cmd |" or die "$0: ERROR: cannot run $cmd\n";
+    push @running, [$i, $fh];
+}
+while (@running) {
+    ($config, $fh) = @{shift @running};
+    collect($config, $fh);
+}
+
+#
+# Print every configuration with its score, the weighted performance
+# index as computed by mdriver
+#
+$best = -1;
+printf "%6s%8s%8s%8s  %s\n", "config", "util", "Kops", "score", "parameters";
+for ($i = 0; $i < @configs; $i++) {
+    if (!$valid[$i]) {
+	printf "%6d%8s%8s%8s  %s\n", $i, "-", "-", "-", config_name($i);
+	next;
+    }
+    $thru = ($cap[$i] and $kops[$i] < $cap[$i]) ? $kops[$i] / $cap[$i] : 1;
+    $score[$i] = $weight * $util[$i] + (1 - $weight) * $thru;
+    printf "%6d%7.0f%%%8d%8.1f  %s\n", $i, $util[$i] * 100, $kops[$i],
+        $score[$i] * 100, config_name($i);
+    if ($best < 0 or $score[$i] > $score[$best]) {
+	$best = $i;
+    }
+}
+if ($best < 0) {
+    die "$0: ERROR: no configuration ran correctly\n";
+}
+
+#
+# The Pareto frontier: the configurations that no other configuration
+# beats in both utilization and throughput, by decreasing utilization
+#
+@frontier = ();
+foreach $i (sort { $util[$b] <=> $util[$a] or $kops[$b] <=> $kops[$a] }
+	    grep { $valid[$_] } (0 .. $#configs)) {
+    if (!@frontier or $kops[$i] > $kops[$frontier[$#frontier]]) {
+	push @frontier, $i;
+    }
+}
+print "\nPareto frontier (util against Kops):\n";
+foreach $i (@frontier) {
+    printf "%6d%7.0f%%%8d%8.1f  %s\n", $i, $util[$i] * 100, $kops[$i],
+        $score[$i] * 100, config_name($i);
+}
+
+printf "\nBest for util weight %.2f: %s (score %.1f)\n", $weight,
+    config_name($best), $score[$best] * 100;
+
+exit;
@@ -49,6 +49,12 @@ $summary = $opt_s;
 #
 %HASH = (); 
 
+#
+# ARENA maps each arena id to the ids allocated in it since its last
+# reset. A reset request releases all of them at once.
+#
+%ARENA = ();
+
 # Read the trace header values
 $heap_size = <STDIN>;
 chomp($heap_size);
@@ -81,6 +87,39 @@ while ($line = <STDIN>) {
     # save the line for output later
     $lines[$requestnum++] = $line;
 
+    # arena requests: "A <arena> <id> <bytes>" and "R <arena>"
+    if ($cmd eq "A") {
+	($cmd, $arena, $id, $size) = split(" ", $line);
+	if (exists($HASH{$id})) {
+	    die "$0: ERROR[$linenum]: reused ID $id.\n";
+	}
+	$HASH{$id} = "A";
+	push @{$ARENA{$arena}}, $id;
+	next;
+    }
+
+    if ($cmd eq "R") {
+	foreach $aid (@{$ARENA{$id}}) {
+	    delete $HASH{$aid};
+	}
+	delete $ARENA{$id};
+	next;
+    }
+
+    if ($HASH{$id} eq "A") {
+	die "$0: ERROR[$linenum]: arena block used outside its arena.\n";
+    }
+
+    # compaction requests: "c"
+    if ($cmd eq "c") {
+	next;
+    }
+
+    # handle blocks ("h <id> <bytes>") are freed like others, never realloced
+    if ($cmd eq "r" and $HASH{$id} eq "h") {
+	die "$0: ERROR[$linenum]: realloc of a handle block\n";
+    }
+
     #ignore realloc requests, as long as they are preceeded by an alloc request
     if ($cmd eq "r") {
 	if (!$HASH{$id}) {
@@ -89,11 +128,11 @@ while ($line = <STDIN>) {
 	next;
     }
 
-    if ($cmd eq "a" and $HASH{$id} eq "a") {
+    if (($cmd eq "a" or $cmd eq "h") and ($HASH{$id} eq "a" or $HASH{$id} eq "h")) {
 	die "$0: ERROR[$linenum]: allocate with no intervening free.\n";
     }
 
-    if ($cmd eq "a" and $HASH{$id} eq "f") {
+    if (($cmd eq "a" or $cmd eq "h") and $HASH{$id} eq "f") {
 	die "$0: ERROR[$linenum]: reused ID $id.\n";
     }
 
@@ -131,7 +170,12 @@ if ($summary) {
 #
 # Output a balanced version of the trace
 #
-$new_ops = keys %HASH;
+$new_ops = keys %ARENA;
+foreach $key (keys %HASH) {
+    if ($HASH{$key} ne "A") {
+	$new_ops++;
+    }
+}
 $new_num_ops = $old_num_ops + $new_ops;
 
 print "$heap_size\n";
@@ -144,9 +188,15 @@ foreach $item (@lines) {
     print "$item\n";
 }
 
-# print a set of free requests that will balance the trace
+# print a set of free and reset requests that will balance the trace
+foreach $key (sort keys %ARENA) {
+    print "R $key\n";
+    foreach $aid (@{$ARENA{$key}}) {
+	delete $HASH{$aid};
+    }
+}
 foreach $key (sort keys %HASH) {
-    if ($HASH{$key} ne "a" and $HASH{$key} ne "r") {
+    if ($HASH{$key} ne "a" and $HASH{$key} ne "r" and $HASH{$key} ne "h") {
 	die "$0: ERROR: Invalid free request in residue.\n";
     }
     print "f $key\n";
@@ -0,0 +1,77 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+$out_filename = "arena.rep";
+$num_rounds = 150;              # rounds of requests
+$num_arenas = 4;                # requests in flight per round, one arena each
+$min_objs = 8;                  # short-lived objects per request
+$max_objs = 64;
+@obj_sizes = (24, 40, 72, 16, 128, 56, 200, 512);
+$long_size = 96;                # one long-lived block per round...
+$long_life = 10;                # ... freed this many rounds later
+
+srand(1);
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Generate the requests first, since the header needs their count
+@ops = ();
+@long_ids = ();
+$blk = 0;
+$max_size = 0;
+
+for ($i = 0;  $i < $num_rounds; $i += 1) {
+    # Every request in the round allocates its objects interleaved
+    # with the other requests, in its own arena
+    for ($a = 0; $a < $num_arenas; $a += 1) {
+	$left[$a] = $min_objs + int(rand($max_objs - $min_objs + 1));
+    }
+    $pending = 1;
+    while ($pending) {
+	$pending = 0;
+	for ($a = 0; $a < $num_arenas; $a += 1) {
+	    if ($left[$a] > 0) {
+		$size = $obj_sizes[int(rand(@obj_sizes))];
+		push @ops, "A $a $blk $size";
+		$blk += 1;
+		$left[$a] -= 1;
+		$max_size += $size;
+		$pending = 1;
+	    }
+	}
+    }
+
+    # A long-lived allocation that outlives several rounds
+    push @ops, "a $blk $long_size";
+    push @long_ids, $blk;
+    $blk += 1;
+    if (@long_ids > $long_life) {
+	$id = shift @long_ids;
+	push @ops, "f $id";
+    }
+
+    # All of the round's short-lived objects die together
+    for ($a = 0; $a < $num_arenas; $a += 1) {
+	push @ops, "R $a";
+    }
+}
+
+foreach $id (@long_ids) {
+    push @ops, "f $id";
+}
+
+$suggested_heap_size = $max_size + 100;
+$num_blocks = $blk;
+$num_ops = @ops;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+foreach $op (@ops) {
+    print OUTFILE "$op\n";
+}
+
+close OUTFILE;
@@ -0,0 +1,81 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+$out_filename = "compact.rep";
+$num_entries = 2000;            # handle blocks in the full cache
+$keep_frac = 0.2;               # share of the entries that survive the shrink
+$num_fixed = 40;                # ordinary (immovable) blocks among them
+$num_churn = 4000;              # replacements after the shrink
+$compact_every = 1000;          # ... with a compaction this often
+@entry_sizes = (24, 48, 100, 160, 256, 400, 640);
+$fixed_size = 72;
+
+srand(1);
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+@ops = ();
+$blk = 0;
+$max_size = 0;
+
+# Fill the cache with handle blocks, with a few ordinary blocks
+# scattered among the first quarter (long-lived startup data)
+@live = ();
+@fixed = ();
+for ($i = 0; $i < $num_entries; $i += 1) {
+    $size = $entry_sizes[int(rand(@entry_sizes))];
+    push @ops, "h $blk $size";
+    push @live, $blk;
+    $blk += 1;
+    $max_size += $size;
+    if ($i < $num_entries / 4 and $i % int($num_entries / (4 * $num_fixed)) == 0) {
+	push @ops, "a $blk $fixed_size";
+	push @fixed, $blk;
+	$blk += 1;
+	$max_size += $fixed_size;
+    }
+}
+
+# The working set shrinks: evict random entries, then compact
+for ($i = $#live; $i > 0; $i -= 1) {
+    $j = int(rand($i + 1));
+    @live[$i, $j] = @live[$j, $i];
+}
+$num_keep = int($num_entries * $keep_frac);
+foreach $id (splice(@live, $num_keep)) {
+    push @ops, "f $id";
+}
+push @ops, "c";
+
+# Steady state on the smaller working set, compacting now and then
+for ($i = 1; $i <= $num_churn; $i += 1) {
+    $k = int(rand(@live));
+    push @ops, "f $live[$k]";
+    $size = $entry_sizes[int(rand(@entry_sizes))];
+    push @ops, "h $blk $size";
+    $live[$k] = $blk;
+    $blk += 1;
+    if ($i % $compact_every == 0) {
+	push @ops, "c";
+    }
+}
+
+foreach $id (@live, @fixed) {
+    push @ops, "f $id";
+}
+
+$suggested_heap_size = $max_size + 100;
+$num_blocks = $blk;
+$num_ops = @ops;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+foreach $op (@ops) {
+    print OUTFILE "$op\n";
+}
+
+close OUTFILE;
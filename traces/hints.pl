@@ -0,0 +1,100 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+use Getopt::Std;
+
+#######################################################################
+# hints - add lifetime hints to the allocate requests of a trace
+#
+# This script reads a Malloc Lab trace file and writes it back with a
+# lifetime hint on each allocate request, taken from when the block is
+# really freed: "p" (permanent) if it is only freed by the run of free
+# requests that ends the trace, "l" (long) if it lives for at least a
+# fraction -l of the trace's requests, and "s" (short) otherwise. The
+# hints are what a program that knows its allocations would pass to
+# mm_malloc_hint.
+#
+#######################################################################
+
+$| = 1; # autoflush output on every print statement
+
+#
+# void usage(void) - print help message and terminate
+#
+sub usage
+{
+    printf STDERR "$_[0]\n";
+    printf STDERR "Usage: $0 [-h] [-l <frac>] < <trace> > <hinted trace>\n";
+    printf STDERR "Options:\n";
+    printf STDERR "  -h          Print this message\n";
+    printf STDERR "  -l <frac>   Shortest long lifetime, as a share of the requests\n";
+    printf STDERR "              (default 0.05)\n";
+    die "\n" ;
+}
+
+##############
+# Main routine
+##############
+
+#
+# Parse and check the command line arguments
+#
+getopts('hl:');
+if ($opt_h) {
+    usage("");
+}
+$long_frac = defined($opt_l) ? $opt_l : 0.05;
+if ($long_frac < 0 or $long_frac > 1) {
+    usage("$0: ERROR: the -l fraction must be from 0 to 1");
+}
+
+# Read the trace header values
+for ($i = 0; $i < 4; $i++) {
+    $header[$i] = <STDIN>;
+}
+$num_ops = $header[2];
+chomp($num_ops);
+
+# Read the requests, and find when each allocate request is freed
+$n = 0;
+while ($line = <STDIN>) {
+    chomp($line);
+    ($cmd, $id, $size) = split(" ", $line);
+
+    # ignore blank lines
+    if (!$cmd) {
+	next;
+    }
+    $lines[$n] = $line;
+    if ($cmd eq "a") {
+	$alloc_at{$id} = $n;
+    }
+    elsif ($cmd eq "f") {
+	$free_at{$id} = $n;
+    }
+    $n++;
+}
+
+# The run of frees that ends the trace releases the permanent blocks
+for ($tail = $n; $tail > 0 and $lines[$tail - 1] =~ /^f /; $tail--) {
+}
+
+print @header;
+for ($i = 0; $i < $n; $i++) {
+    ($cmd, $id, $size) = split(" ", $lines[$i]);
+    if ($cmd ne "a") {
+	print "$lines[$i]\n";
+	next;
+    }
+    if (!defined($free_at{$id}) or $free_at{$id} >= $tail) {
+	$hint = "p";
+    }
+    elsif ($free_at{$id} - $i >= $long_frac * $num_ops) {
+	$hint = "l";
+    }
+    else {
+	$hint = "s";
+    }
+    print "a $id $size $hint\n";
+}
+
+exit;
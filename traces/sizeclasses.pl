@@ -0,0 +1,283 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+use Getopt::Std;
+
+#######################################################################
+# sizeclasses - derive segregated-list size classes from a set of traces
+#
+# This script reads Malloc Lab trace files and computes a table of size
+# classes for the segregated free lists, fitted to the block sizes that
+# the traces actually request. It writes a C header that defines the
+# classes and a size->class lookup table for the seglist allocator.
+#
+# Each distinct block size is weighted by its share of the requests and
+# its share of the live bytes (bytes times lifetime, in requests). The
+# script starts with one class per block size and repeatedly merges the
+# pair of neighbouring classes whose merge adds the least weighted
+# internal fragmentation, i.e. the least sum of w(s) * (1 - s/max) for
+# the sizes s in a class of max size max. Merges that keep every class
+# within the fragmentation bound (-f) are preferred. The last class has
+# no upper bound and takes all larger blocks.
+#
+#######################################################################
+
+$| = 1; # autoflush output on every print statement
+
+#
+# void usage(void) - print help message and terminate
+#
+sub usage
+{
+    printf STDERR "$_[0]\n";
+    printf STDERR "Usage: $0 [-h] [-n <classes>] [-f <frag>] [-w <weight>] <trace>...\n";
+    printf STDERR "Options:\n";
+    printf STDERR "  -h          Print this message\n";
+    printf STDERR "  -n <n>      Number of size classes (default 20)\n";
+    printf STDERR "  -f <frag>   Preferred bound on the fragmentation of a class,\n";
+    printf STDERR "              as max/min - 1 of its sizes (default 0.25)\n";
+    printf STDERR "  -w <weight> Weight of the request share against the live\n";
+    printf STDERR "              byte share, from 0 to 1 (default 0.5)\n";
+    printf STDERR "Writes the header to stdout and a summary to stderr.\n";
+    die "\n" ;
+}
+
+#
+# int block_size(int bytes) - the block size that the allocators
+# request for a payload of the given size: the payload plus header and
+# footer, rounded up to ALIGNMENT (see ALIGN and SIZE_T_SIZE in the mm
+# sources)
+#
+sub block_size
+{
+    my $size = ($_[0] + $size_t_size + $alignment - 1) & ~($alignment - 1);
+    return ($size < $min_block) ? $min_block : $size;
+}
+
+##############
+# Main routine
+##############
+
+#
+# Parse and check the command line arguments
+#
+getopts('hn:f:w:');
+if ($opt_h) {
+    usage("");
+}
+$num_classes = defined($opt_n) ? $opt_n : 20;
+$frag_bound = defined($opt_f) ? $opt_f : 0.25;
+$count_weight = defined($opt_w) ? $opt_w : 0.5;
+if ($num_classes < 2 or $num_classes > 255) {
+    usage("$0: ERROR: the number of classes must be from 2 to 255");
+}
+if (!@ARGV) {
+    usage("$0: ERROR: no trace files");
+}
+
+$alignment = 8;                 # ALIGNMENT in the mm sources
+$size_t_size = 8;               # room for the header and footer
+$min_block = 16;                # smallest block (header, footer, 2 links)
+$lookup_max = 4096;             # largest size in the direct lookup table
+
+#
+# COUNT and LIVE accumulate, for each block size, the number of requests
+# and the live bytes (size times lifetime in requests). Arena requests
+# are skipped, since their blocks never reach the free lists.
+#
+%COUNT = ();
+%LIVE = ();
+$total_count = 0;
+$total_live = 0;
+
+foreach $file (@ARGV) {
+    open TRACE, "<$file" or die "$0: ERROR: cannot open $file\n";
+
+    # Skip the trace header values
+    for ($i = 0; $i < 4; $i++) {
+	$line = <TRACE>;
+    }
+
+    %born = ();
+    %size = ();
+    $opnum = 0;
+    while ($line = <TRACE>) {
+	($cmd, $id, $bytes) = split(" ", $line);
+	if (!$cmd) {
+	    next;
+	}
+	$opnum++;
+
+	# A realloc ends the life of the old block and starts a new one
+	if (($cmd eq "r" or $cmd eq "f") and exists($born{$id})) {
+	    $LIVE{$size{$id}} += $size{$id} * ($opnum - $born{$id});
+	    $total_live += $size{$id} * ($opnum - $born{$id});
+	    delete $born{$id};
+	}
+	if ($cmd eq "a" or $cmd eq "r") {
+	    $size{$id} = block_size($bytes);
+	    $born{$id} = $opnum;
+	    $COUNT{$size{$id}}++;
+	    $total_count++;
+	}
+    }
+    close TRACE;
+
+    # Blocks still live at the end of an unbalanced trace
+    foreach $id (keys %born) {
+	$LIVE{$size{$id}} += $size{$id} * ($opnum - $born{$id});
+	$total_live += $size{$id} * ($opnum - $born{$id});
+    }
+}
+
+if ($total_count == 0) {
+    die "$0: ERROR: the traces have no malloc or realloc requests\n";
+}
+
+#
+# Start with one class per block size. For each class keep its max
+# size, its smallest size, the total weight W and the sum of w(s) * s,
+# so that the fragmentation cost of a class is W - WS/max.
+#
+@sizes = sort { $a <=> $b } keys %COUNT;
+@max = ();
+@min = ();
+@w = ();
+@ws = ();
+foreach $s (@sizes) {
+    $weight = $count_weight * $COUNT{$s} / $total_count;
+    if ($total_live > 0) {
+	$weight += (1 - $count_weight) * $LIVE{$s} / $total_live;
+    }
+    push @max, $s;
+    push @min, $s;
+    push @w, $weight;
+    push @ws, $weight * $s;
+}
+$max[$#max] = 0;                # the last class is unbounded
+
+#
+# double merge_cost(int i) - the fragmentation added by merging class i
+# into class i+1, whose max size the merged class keeps
+#
+sub merge_cost
+{
+    my $i = $_[0];
+    my $inv_old = 1 / $max[$i];
+    my $inv_new = $max[$i+1] ? 1 / $max[$i+1] : 0;
+    return $ws[$i] * ($inv_old - $inv_new);
+}
+
+#
+# int within_bound(int i) - would the class merged from classes i and
+# i+1 keep its sizes within the fragmentation bound?
+#
+sub within_bound
+{
+    my $i = $_[0];
+    my $top = $max[$i+1] ? $max[$i+1] : $sizes[$#sizes];
+    return $top <= $min[$i] * (1 + $frag_bound);
+}
+
+# Cache the merge cost and bound of each neighbouring pair of classes
+@cost = ();
+@bounded = ();
+for ($i = 0; $i < $#max; $i++) {
+    $cost[$i] = merge_cost($i);
+    $bounded[$i] = within_bound($i);
+}
+
+$over_bound = 0;
+while (@max > $num_classes) {
+    $best = 0;
+    for ($i = 1; $i < $#max; $i++) {
+	if (($bounded[$i] and !$bounded[$best]) or
+	    ($bounded[$i] == $bounded[$best] and $cost[$i] < $cost[$best])) {
+	    $best = $i;
+	}
+    }
+    if (!$bounded[$best]) {
+	$over_bound++;
+    }
+
+    # Merge class best into class best+1, which then moves down to best
+    $w[$best+1] += $w[$best];
+    $ws[$best+1] += $ws[$best];
+    $min[$best+1] = $min[$best];
+    splice(@max, $best, 1);
+    splice(@min, $best, 1);
+    splice(@w, $best, 1);
+    splice(@ws, $best, 1);
+    splice(@cost, $best, 1);
+    splice(@bounded, $best, 1);
+
+    # Only the pairs next to the merged class have changed
+    for ($i = $best - 1; $i <= $best; $i++) {
+	if ($i >= 0 and $i < $#max) {
+	    $cost[$i] = merge_cost($i);
+	    $bounded[$i] = within_bound($i);
+	}
+    }
+}
+
+#
+# Print a summary of the classes
+#
+printf STDERR "%5s%10s%10s%8s%8s\n", "class", "min", "max", "weight", "frag";
+$total_frag = 0;
+for ($i = 0; $i < @max; $i++) {
+    $frag = $max[$i] ? $w[$i] - $ws[$i] / $max[$i] : $w[$i];
+    $total_frag += $frag;
+    printf STDERR "%5d%10d%10s%8.3f%8.3f\n", $i, $min[$i],
+        $max[$i] ? $max[$i] : "-", $w[$i], $frag;
+}
+printf STDERR "weighted fragmentation %.3f, %d merges over the bound\n",
+    $total_frag, $over_bound;
+
+#
+# Output the header
+#
+$num_classes = @max;
+print "/*\n";
+print " * size_classes.h - Size classes for the segregated free lists\n";
+print " *\n";
+print " * Generated by traces/sizeclasses.pl -n $num_classes -f $frag_bound -w $count_weight from\n";
+foreach $file (@ARGV) {
+    $file =~ s/.*\///;
+    print " *     $file\n";
+}
+print " * Do not edit; rerun the script instead.\n";
+print " */\n";
+print "#ifndef __SIZE_CLASSES_H_\n";
+print "#define __SIZE_CLASSES_H_\n\n";
+
+print "#define SIZE_CLASSES $num_classes\n";
+print "#define SIZE_CLASS_GRAIN $alignment\n";
+print "#define SIZE_CLASS_LOOKUP_MAX $lookup_max\n\n";
+
+print "/* Largest block size in each class (0: the last class is unbounded) */\n";
+print "static const size_t size_class_max[SIZE_CLASSES] = {";
+for ($i = 0; $i < @max; $i++) {
+    print (($i % 8) ? " " : "\n    ");
+    print "$max[$i]";
+    print "," if ($i < $#max);
+}
+print "\n};\n\n";
+
+print "/* Class of each block size up to SIZE_CLASS_LOOKUP_MAX, indexed by\n";
+print "   size / SIZE_CLASS_GRAIN */\n";
+print "static const unsigned char size_class_lookup[SIZE_CLASS_LOOKUP_MAX / SIZE_CLASS_GRAIN + 1] = {";
+$class = 0;
+for ($i = 0; $i <= $lookup_max / $alignment; $i++) {
+    $s = $i * $alignment;
+    while ($max[$class] and $s > $max[$class]) {
+	$class++;
+    }
+    print (($i % 16) ? " " : "\n    ");
+    print "$class";
+    print "," if ($i < $lookup_max / $alignment);
+}
+print "\n};\n\n";
+
+print "#endif /* __SIZE_CLASSES_H_ */\n";
+
+exit;
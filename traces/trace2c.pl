@@ -0,0 +1,188 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+use Getopt::Std;
+
+#######################################################################
+# trace2c - compile Malloc Lab traces into C benchmark kernels
+#
+# This script reads Malloc Lab trace files and writes a C file with one
+# kernel function per trace. A kernel replays its trace as straight-line
+# calls to mm_malloc, mm_realloc and mm_free, with the block pointers
+# in a local array, so that timing it charges the allocator and not the
+# driver's trace interpreter. The file ends with a table of the kernels
+# (see kernels.h) that mdriver -k looks the traces up in.
+#
+# The calls are split into functions of at most -c requests each, which
+# the kernel calls in turn: compilers take much longer to optimize one
+# huge function than many small ones.
+#
+# The kernels do not check the results of the calls; mdriver checks the
+# same traces for correctness before it times their kernels. Only
+# allocate, reallocate and free requests can be compiled. Each request
+# makes the call that mdriver's interpreter makes for it, so that the
+# two times differ only by the interpreter: a free passes the block's
+# requested size to mm_free_sized, and an allocate request with a
+# lifetime hint calls mm_malloc_hint, if the allocator defines them.
+#
+#######################################################################
+
+$| = 1; # autoflush output on every print statement
+
+#
+# void usage(void) - print help message and terminate
+#
+sub usage
+{
+    printf STDERR "$_[0]\n";
+    printf STDERR "Usage: $0 [-h] [-c <requests>] <trace>...\n";
+    printf STDERR "Options:\n";
+    printf STDERR "  -h          Print this message\n";
+    printf STDERR "  -c <n>      Requests per function (default 1000)\n";
+    printf STDERR "Writes the kernels to stdout.\n";
+    die "\n" ;
+}
+
+##############
+# Main routine
+##############
+
+#
+# Parse and check the command line arguments
+#
+getopts('hc:');
+if ($opt_h) {
+    usage("");
+}
+$chunk = defined($opt_c) ? $opt_c : 1000;
+if ($chunk < 1) {
+    usage("$0: ERROR: the requests per function must be at least 1");
+}
+if (!@ARGV) {
+    usage("$0: ERROR: no trace files");
+}
+
+print "/*\n";
+print " * kernels.c - Trace kernels for mdriver -k\n";
+print " *\n";
+print " * Generated by traces/trace2c.pl from\n";
+foreach $file (@ARGV) {
+    ($name = $file) =~ s/.*\///;
+    print " *     $name\n";
+}
+print " * Do not edit; rerun the script instead.\n";
+print " */\n";
+print "#include <stdlib.h>\n";
+print "\n";
+print "#include \"mm.h\"\n";
+print "#include \"kernels.h\"\n";
+print "\n";
+print "/* The same calls as mdriver makes, with the optional extensions weak */\n";
+print "#pragma weak mm_free_sized\n";
+print "#pragma weak mm_malloc_hint\n";
+print "\n";
+print "#define FREE(p, size) \\\n";
+print "    (mm_free_sized != NULL ? mm_free_sized(p, size) : mm_free(p))\n";
+print "#define MALLOC_HINT(size, hint) \\\n";
+print "    (mm_malloc_hint != NULL ? mm_malloc_hint(size, hint) : mm_malloc(size))\n";
+
+# The mm.h names of the lifetime hints
+%hints = ("s" => "MM_HINT_SHORT", "l" => "MM_HINT_LONG",
+	  "p" => "MM_HINT_PERMANENT");
+
+#
+# Compile each trace into a kernel k<n>, which calls the functions
+# k<n>_0, k<n>_1, ... that hold its requests
+#
+$n = 0;
+foreach $file (@ARGV) {
+    open TRACE, "<$file" or die "$0: ERROR: Cannot open $file\n";
+    ($name = $file) =~ s/.*\///;
+
+    # Read the trace header values
+    $heap_size = <TRACE>;
+    $num_ids = <TRACE>;
+    chomp($num_ids);
+    $num_ops = <TRACE>;
+    chomp($num_ops);
+    $weight = <TRACE>;
+
+    print "\n";
+    print "/* $name: $num_ops requests on $num_ids blocks */\n";
+
+    $linenum = 4;
+    $ops = 0;
+    %sizes = ();
+    while ($line = <TRACE>) {
+	chomp($line);
+	$linenum++;
+
+	($cmd, $id, $size, $hint) = split(" ", $line);
+
+	# ignore blank lines
+	if (!$cmd) {
+	    next;
+	}
+	if ($ops % $chunk == 0) {
+	    if ($ops > 0) {
+		print "}\n\n";
+	    }
+	    printf "static void k%d_%d(char **p)\n{\n", $n, $ops / $chunk;
+	}
+	$ops++;
+
+	if ($cmd eq "a" and $hint) {
+	    print "    p[$id] = MALLOC_HINT($size, $hints{$hint});\n";
+	    $sizes{$id} = $size;
+	}
+	elsif ($cmd eq "a") {
+	    print "    p[$id] = mm_malloc($size);\n";
+	    $sizes{$id} = $size;
+	}
+	elsif ($cmd eq "r") {
+	    print "    p[$id] = mm_realloc(p[$id], $size);\n";
+	    $sizes{$id} = $size;
+	}
+	elsif ($cmd eq "f") {
+	    # The size of the block's last allocate or reallocate request
+	    print "    FREE(p[$id], $sizes{$id});\n";
+	}
+	else {
+	    die "$0: ERROR: $name:$linenum: cannot compile request \"$cmd\"\n";
+	}
+    }
+    close TRACE;
+
+    if ($ops != $num_ops) {
+	die "$0: ERROR: $name has $ops requests, not $num_ops\n";
+    }
+    if ($ops > 0) {
+	print "}\n";
+    }
+
+    print "\n";
+    print "static void k$n(void)\n";
+    print "{\n";
+    print "    char *p[$num_ids];\n";
+    print "\n";
+    for ($i = 0; $i * $chunk < $ops; $i++) {
+	print "    k${n}_$i(p);\n";
+    }
+    print "}\n";
+
+    $names[$n] = $name;
+    $counts[$n] = $num_ops;
+    $n++;
+}
+
+#
+# The table of kernels, terminated by a null entry
+#
+print "\n";
+print "kernel_t kernels[] = {\n";
+for ($i = 0; $i < $n; $i++) {
+    print "    {\"$names[$i]\", $counts[$i], k$i},\n";
+}
+print "    {NULL, 0, NULL}\n";
+print "};\n";
+
+exit;